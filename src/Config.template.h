@@ -10,6 +10,7 @@ constexpr bool SNAPSHOT                 = @SNAPSHOT@;
 constexpr bool MOD                      = @MOD@;
 constexpr bool NOHTTP                   = @NOHTTP@;
 constexpr bool LUACONSOLE               = @LUACONSOLE@;
+constexpr bool LUA_FFI                  = @LUA_FFI@;
 constexpr bool ALLOW_FAKE_NEWER_VERSION = @ALLOW_FAKE_NEWER_VERSION@;
 constexpr bool USE_UPDATESERVER         = @USE_UPDATESERVER@;
 constexpr bool CAN_INSTALL              = @CAN_INSTALL@;
@@ -24,6 +25,7 @@ constexpr bool FFTW_PLAN_MEASURE        = @FFTW_PLAN_MEASURE@;
 constexpr bool ALLOW_QUIT               = @ALLOW_QUIT@;
 constexpr bool DEFAULT_TOUCH_UI         = @DEFAULT_TOUCH_UI@;
 constexpr bool ALLOW_DATA_FOLDER        = @ALLOW_DATA_FOLDER@;
+constexpr bool SIM_THREADS              = @SIM_THREADS@;
 constexpr char PATH_SEP_CHAR            = '@PATH_SEP_CHAR@';
 
 enum ForceWindowFrameOps
@@ -65,6 +67,9 @@ constexpr char STATICSCHEME[]   = "https://";
 constexpr char LOCAL_SAVE_DIR[] = "Saves";
 constexpr char STAMPS_DIR[]     = "stamps";
 constexpr char BRUSH_DIR[]      = "Brushes";
+constexpr char HTTP_CACHE_DIR[] = "httpcache";
 
 constexpr int httpMaxConcurrentStreams = 50;
 constexpr int httpConnectTimeoutS      = 15;
+constexpr int httpCacheMaxBytes        = 64 * 1024 * 1024;
+constexpr int imageCacheMaxBytes       = 32 * 1024 * 1024;
@@ -0,0 +1,199 @@
+#include "common/String.h"
+#include "common/platform/Platform.h"
+#include "Format.h"
+#include "client/GameSave.h"
+#include "simulation/Air.h"
+#include "simulation/Simulation.h"
+#include "simulation/SimulationData.h"
+#include "simulation/Snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Time spent in each phase of a tick, over a whole run.
+	struct Timings
+	{
+		Clock::duration beforeSim{};
+		Clock::duration updateParticles{};
+		Clock::duration afterSim{};
+
+		Clock::duration Total() const
+		{
+			return beforeSim + updateParticles + afterSim;
+		}
+	};
+
+	struct RunResult
+	{
+		uint32_t hash;
+		Timings timings;
+	};
+
+	// Same as what GameModel does when a save is opened, minus everything UI.
+	// Newtonian gravity is not started: results from the gravity thread
+	// arrive whenever it happens to finish, so it can never be reproduced.
+	RunResult Run(const GameSave &save, int ticks)
+	{
+		auto sim = std::make_unique<Simulation>();
+		sim->gravityMode = save.gravityMode;
+		sim->customGravityX = save.customGravityX;
+		sim->customGravityY = save.customGravityY;
+		sim->air->airMode = save.airMode;
+		sim->heatMode = (save.heatMode >= 0 && save.heatMode < NUM_HEATMODES) ? save.heatMode : HEAT_STOCHASTIC;
+		sim->air->ambientAirTemp = save.ambientAirTemp;
+		sim->legacy_enable = save.legacyEnable;
+		sim->water_equal_test = save.waterEEnabled;
+		sim->aheat_enable = save.aheatEnable;
+		sim->SetEdgeMode(save.edgeMode);
+		sim->Load(&save, true, { 0, 0 });
+		sim->frameCount = save.frameCount;
+		if (save.hasRngState)
+		{
+			sim->rng.state(save.rngState);
+		}
+		else
+		{
+			// the default seed is the current time
+			sim->rng.seed(0);
+		}
+		sim->ensureDeterminism = true;
+
+		RunResult result;
+		for (int tick = 0; tick < ticks; ++tick)
+		{
+			auto start = Clock::now();
+			sim->BeforeSim();
+			auto beforeSimDone = Clock::now();
+			sim->UpdateParticles(0, NPART);
+			auto updateParticlesDone = Clock::now();
+			sim->AfterSim();
+			auto afterSimDone = Clock::now();
+			result.timings.beforeSim += beforeSimDone - start;
+			result.timings.updateParticles += updateParticlesDone - beforeSimDone;
+			result.timings.afterSim += afterSimDone - updateParticlesDone;
+		}
+		result.hash = sim->CreateSnapshot()->Hash();
+		return result;
+	}
+
+	void Report(const char *phase, Clock::duration duration, int ticks)
+	{
+		auto seconds = std::chrono::duration<double>(duration).count();
+		std::cout << "  " << phase << ": " << seconds * 1000.0 / ticks << " ms/tick";
+		if (seconds > 0)
+		{
+			std::cout << ", " << ticks / seconds << " ticks/s";
+		}
+		std::cout << std::endl;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << argv[0] << " <inputFilename> [ticks:N] [runs:N] [hash:XXXXXXXX]" << std::endl;
+		return 1;
+	}
+	auto inputFilename = ByteString(argv[1]);
+
+	std::map<ByteString, ByteString> arguments;
+	for (int i = 2; i < argc; ++i)
+	{
+		auto str = ByteString(argv[i]);
+		if (auto split = str.SplitBy(':'))
+		{
+			arguments.insert({ split.Before(), split.After() });
+		}
+	}
+	int ticks = 1000;
+	int runs = 2;
+	std::optional<uint32_t> expectedHash;
+	try
+	{
+		if (arguments.count("ticks"))
+		{
+			ticks = std::max(arguments["ticks"].ToNumber<int>(), 1);
+		}
+		if (arguments.count("runs"))
+		{
+			runs = std::max(arguments["runs"].ToNumber<int>(), 1);
+		}
+		if (arguments.count("hash"))
+		{
+			expectedHash = arguments["hash"].ToNumber<uint32_t>(Format::Hex());
+		}
+	}
+	catch (const std::runtime_error &)
+	{
+		std::cerr << "invalid argument" << std::endl;
+		return 1;
+	}
+
+	auto simulationData = std::make_unique<SimulationData>();
+
+	std::vector<char> fileData;
+	if (!Platform::ReadFile(fileData, inputFilename))
+	{
+		return 1;
+	}
+	std::unique_ptr<GameSave> gameSave;
+	try
+	{
+		gameSave = std::make_unique<GameSave>(fileData, false);
+	}
+	catch (const ParseException &e)
+	{
+		std::cerr << "cannot load " << inputFilename << ": " << e.what() << std::endl;
+		return 1;
+	}
+	if (gameSave->gravityEnable)
+	{
+		std::cerr << "warning: " << inputFilename << " has Newtonian gravity enabled, running without it" << std::endl;
+	}
+
+	// Every run starts from the same save, so any difference between them
+	// means something outside the saved state, such as thread timing or
+	// uninitialised memory, leaked into the simulation.
+	std::optional<RunResult> best;
+	std::optional<uint32_t> firstHash;
+	bool ok = true;
+	for (int run = 0; run < runs; ++run)
+	{
+		auto result = Run(*gameSave, ticks);
+		std::cout << "run " << run << ": hash " << ByteString::Build(Format::Hex(), Format::Width(8), Format::Fill('0'), result.hash) << std::endl;
+		if (!firstHash)
+		{
+			firstHash = result.hash;
+		}
+		else if (result.hash != *firstHash)
+		{
+			std::cerr << "run " << run << " diverged from run 0" << std::endl;
+			ok = false;
+		}
+		if (!best || result.timings.Total() < best->timings.Total())
+		{
+			best = result;
+		}
+	}
+
+	std::cout << ticks << " ticks, fastest of " << runs << " runs:" << std::endl;
+	Report("BeforeSim", best->timings.beforeSim, ticks);
+	Report("UpdateParticles", best->timings.updateParticles, ticks);
+	Report("AfterSim", best->timings.afterSim, ticks);
+	Report("total", best->timings.Total(), ticks);
+
+	if (expectedHash && *firstHash != *expectedHash)
+	{
+		std::cerr << "hash mismatch: expected " << ByteString::Build(Format::Hex(), Format::Width(8), Format::Fill('0'), *expectedHash) << std::endl;
+		ok = false;
+	}
+	return ok ? 0 : 1;
+}
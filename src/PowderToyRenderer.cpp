@@ -8,19 +8,138 @@
 #include "simulation/Simulation.h"
 #include "simulation/SimulationData.h"
 #include "common/platform/Platform.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <ctime>
+#include <deque>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <vector>
 
+namespace
+{
+	// Frames are handed from the simulation thread to the encoders through a
+	// bounded queue so that a slow encoder stalls the simulation instead of
+	// letting dumped frames pile up in memory.
+	class FrameQueue
+	{
+		struct Frame
+		{
+			int index;
+			VideoBuffer buffer;
+		};
+		std::mutex mx;
+		std::condition_variable cv;
+		std::deque<Frame> frames;
+		size_t capacity;
+		bool closed = false;
+
+	public:
+		FrameQueue(size_t newCapacity) : capacity(newCapacity)
+		{
+		}
+
+		void Push(int index, VideoBuffer buffer)
+		{
+			std::unique_lock lk(mx);
+			cv.wait(lk, [this] { return frames.size() < capacity; });
+			frames.push_back({ index, std::move(buffer) });
+			cv.notify_all();
+		}
+
+		std::optional<Frame> Pop()
+		{
+			std::unique_lock lk(mx);
+			cv.wait(lk, [this] { return closed || !frames.empty(); });
+			if (frames.empty())
+			{
+				return std::nullopt;
+			}
+			auto frame = std::move(frames.front());
+			frames.pop_front();
+			cv.notify_all();
+			return frame;
+		}
+
+		void Close()
+		{
+			std::unique_lock lk(mx);
+			closed = true;
+			cv.notify_all();
+		}
+	};
+
+	// Raw 4:4:4 BT.601 studio range, which every common encoder accepts as is.
+	void WriteY4MFrame(std::ofstream &output, VideoBuffer const &buffer, std::vector<char> &planes)
+	{
+		auto size = buffer.Size();
+		auto count = size_t(size.X * size.Y);
+		planes.resize(count * 3);
+		auto *data = buffer.Data();
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto colour = RGB<uint8_t>::Unpack(data[i]);
+			int r = colour.Red, g = colour.Green, b = colour.Blue;
+			planes[i            ] = char((( 66 * r + 129 * g +  25 * b + 128) >> 8) +  16);
+			planes[i + count    ] = char(((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+			planes[i + count * 2] = char(((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+		}
+		output << "FRAME\n";
+		output.write(planes.data(), planes.size());
+	}
+}
+
 int main(int argc, char *argv[])
 {
-	if (!argv[1] || !argv[2]) {
-		std::cout << "Usage: " << argv[0] << " <inputFilename> <outputPrefix>" << std::endl;
+	if (argc < 3) {
+		std::cout << "Usage: " << argv[0] << " <inputFilename> <outputPrefix> [frames:N] [every:N] [preset:N] [format:png|y4m] [threads:N]" << std::endl;
 		return 1;
 	}
 	auto inputFilename = ByteString(argv[1]);
-	auto outputFilename = ByteString(argv[2]) + ".png";
+	auto outputPrefix = ByteString(argv[2]);
+	auto outputFilename = outputPrefix + ".png";
+
+	std::map<ByteString, ByteString> arguments;
+	for (int i = 3; i < argc; ++i)
+	{
+		auto str = ByteString(argv[i]);
+		if (auto split = str.SplitBy(':'))
+		{
+			arguments.insert({ split.Before(), split.After() });
+		}
+	}
+	auto numberArg = [&arguments](ByteString name, int def) {
+		auto it = arguments.find(name);
+		if (it == arguments.end())
+		{
+			return def;
+		}
+		try
+		{
+			return it->second.ToNumber<int>();
+		}
+		catch (const std::runtime_error &)
+		{
+			std::cerr << "ignoring invalid " << name << " argument " << it->second << std::endl;
+			return def;
+		}
+	};
+	// Sequence mode: step the simulation frames times and write every nth frame.
+	auto frames = numberArg("frames", 0);
+	auto every = std::max(numberArg("every", 1), 1);
+	auto preset = numberArg("preset", -1);
+	auto threads = std::max(numberArg("threads", int(std::thread::hardware_concurrency()) - 1), 1);
+	auto formatName = arguments.count("format") ? arguments["format"] : ByteString("png");
+	if (formatName != "png" && formatName != "y4m")
+	{
+		std::cerr << "unknown format " << formatName << ", expected png or y4m" << std::endl;
+		return 1;
+	}
 
 	auto simulationData = std::make_unique<SimulationData>();
 
@@ -45,6 +164,103 @@ int main(int argc, char *argv[])
 	Simulation * sim = new Simulation();
 	Renderer * ren = new Renderer(sim);
 
+	if (preset >= 0)
+	{
+		if (preset >= int(ren->renderModePresets.size()))
+		{
+			std::cerr << "preset must be between 0 and " << ren->renderModePresets.size() - 1 << std::endl;
+			return 1;
+		}
+		auto &renderPreset = ren->renderModePresets[preset];
+		ren->SetRenderMode(renderPreset.RenderModes);
+		ren->SetDisplayMode(renderPreset.DisplayModes);
+		ren->SetColourMode(renderPreset.ColourMode);
+	}
+
+	if (gameSave && frames > 0)
+	{
+		sim->Load(gameSave.get(), true, { 0, 0 });
+		ren->decorations_enable = true;
+		ren->blackDecorations = true;
+
+		FrameQueue queue(threads * 2);
+		std::vector<std::thread> encoders;
+		std::atomic<int> failedFrames = 0;
+		std::mutex errorMx;
+		std::ofstream y4m;
+		if (formatName == "y4m")
+		{
+			y4m.open(outputPrefix + ".y4m", std::ios::binary);
+			if (!y4m)
+			{
+				std::cerr << "cannot open " << outputPrefix << ".y4m for writing" << std::endl;
+				return 1;
+			}
+			y4m << "YUV4MPEG2 W" << XRES << " H" << YRES << " F60:" << every << " Ip A1:1 C444\n";
+			// a single writer keeps frames in order, and packing YUV is cheap enough not to need more
+			encoders.emplace_back([&queue, &y4m]() {
+				std::vector<char> planes;
+				while (auto frame = queue.Pop())
+				{
+					WriteY4MFrame(y4m, frame->buffer, planes);
+				}
+			});
+		}
+		else
+		{
+			for (int i = 0; i < threads; ++i)
+			{
+				encoders.emplace_back([&queue, &outputPrefix, &failedFrames, &errorMx]() {
+					while (auto frame = queue.Pop())
+					{
+						auto filename = ByteString::Build(outputPrefix, "_", Format::Width(6), Format::Fill('0'), frame->index, ".png");
+						auto data = frame->buffer.ToPNG();
+						if (!data || !Platform::WriteFile(*data, filename))
+						{
+							failedFrames += 1;
+							std::lock_guard lk(errorMx);
+							std::cerr << "failed to write " << filename << std::endl;
+						}
+					}
+				});
+			}
+		}
+
+		int written = 0;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			sim->BeforeSim();
+			sim->UpdateParticles(0, NPART);
+			sim->AfterSim();
+			if ((frame + 1) % every)
+			{
+				continue;
+			}
+			ren->clearScreen();
+			ren->draw_air();
+			ren->RenderBegin();
+			ren->RenderEnd();
+			queue.Push(written, ren->DumpFrame());
+			written += 1;
+		}
+		queue.Close();
+		for (auto &encoder : encoders)
+		{
+			encoder.join();
+		}
+		if (formatName == "y4m" && !y4m.flush().good())
+		{
+			std::cerr << "failed to write " << outputPrefix << ".y4m" << std::endl;
+			return 1;
+		}
+		if (failedFrames)
+		{
+			std::cerr << failedFrames << " of " << written << " frames failed to write" << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
 	if (gameSave)
 	{
 		sim->Load(gameSave.get(), true, { 0, 0 });
@@ -73,6 +289,11 @@ int main(int argc, char *argv[])
 	ren->RenderBegin();
 	ren->RenderEnd();
 
-	if (auto data = ren->DumpFrame().ToPNG())
-		Platform::WriteFile(*data, outputFilename);
+	auto data = ren->DumpFrame().ToPNG();
+	if (!data || !Platform::WriteFile(*data, outputFilename))
+	{
+		std::cerr << "failed to write " << outputFilename << std::endl;
+		return 1;
+	}
+	return 0;
 }
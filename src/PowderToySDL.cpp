@@ -6,7 +6,10 @@
 #include "graphics/Graphics.h"
 #include "common/platform/Platform.h"
 #include "common/clipboard/Clipboard.h"
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <vector>
 
 int desktopWidth = 1280;
 int desktopHeight = 1024;
@@ -97,9 +100,63 @@ static void CalculateMousePosition(int *x, int *y)
 		*y = (globalMy - windowY) / currentFrameOps.scale;
 }
 
+// Copy of what sdl_texture currently holds, used to upload only the parts of a
+// frame that changed and to skip presenting frames that changed nothing at all.
+static std::vector<pixel> presentedFrame;
+static bool presentedFrameValid = false;
+
 void blit(pixel *vid)
 {
-	SDL_UpdateTexture(sdl_texture, NULL, vid, WINDOWW * sizeof (Uint32));
+	auto dirty = false;
+	if (!presentedFrameValid)
+	{
+		SDL_UpdateTexture(sdl_texture, NULL, vid, WINDOWW * sizeof (Uint32));
+		presentedFrame.assign(vid, vid + WINDOWW * WINDOWH);
+		presentedFrameValid = true;
+		dirty = true;
+	}
+	else
+	{
+		constexpr int bandHeight = 16;
+		for (int top = 0; top < WINDOWH; top += bandHeight)
+		{
+			auto bottom = std::min(top + bandHeight, WINDOWH);
+			auto left = WINDOWW;
+			auto right = 0;
+			for (int y = top; y < bottom; y++)
+			{
+				auto *row = vid + y * WINDOWW;
+				auto *presentedRow = presentedFrame.data() + y * WINDOWW;
+				auto first = int(std::mismatch(row, row + WINDOWW, presentedRow).first - row);
+				if (first == WINDOWW)
+				{
+					continue;
+				}
+				auto last = WINDOWW - int(std::mismatch(
+					std::make_reverse_iterator(row + WINDOWW), std::make_reverse_iterator(row),
+					std::make_reverse_iterator(presentedRow + WINDOWW)
+				).first - std::make_reverse_iterator(row + WINDOWW));
+				left = std::min(left, first);
+				right = std::max(right, last);
+			}
+			if (left >= right)
+			{
+				continue;
+			}
+			SDL_Rect rect{ left, top, right - left, bottom - top };
+			SDL_UpdateTexture(sdl_texture, &rect, vid + top * WINDOWW + left, WINDOWW * sizeof (Uint32));
+			for (int y = top; y < bottom; y++)
+			{
+				std::copy(vid + y * WINDOWW + left, vid + y * WINDOWW + right, presentedFrame.data() + y * WINDOWW + left);
+			}
+			dirty = true;
+		}
+	}
+	// with vsync, presenting is what paces the main loop, so it can't be skipped
+	if (!dirty && !vsyncHint)
+	{
+		return;
+	}
 	// need to clear the renderer if there are black edges (fullscreen, or resizable window)
 	if (currentFrameOps.fullscreen || currentFrameOps.resizable)
 		SDL_RenderClear(sdl_renderer);
@@ -198,6 +255,7 @@ void SDLSetScreen()
 		{
 			SDL_DestroyTexture(sdl_texture);
 			sdl_texture = NULL;
+			presentedFrameValid = false;
 		}
 		if (sdl_renderer)
 		{
@@ -377,6 +435,12 @@ static void EventProcess(const SDL_Event &event)
 	{
 		switch (event.window.event)
 		{
+		case SDL_WINDOWEVENT_EXPOSED:
+		case SDL_WINDOWEVENT_SIZE_CHANGED:
+			// the window contents may have been lost, present a full frame next time around
+			presentedFrameValid = false;
+			break;
+
 		case SDL_WINDOWEVENT_SHOWN:
 			if (!calculatedInitialMouse)
 			{
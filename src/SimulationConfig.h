@@ -39,6 +39,8 @@ constexpr float AIR_TSTEPV = 0.4f;
 constexpr float AIR_VADV   = 0.3f;
 constexpr float AIR_VLOSS  = 0.999f;
 constexpr float AIR_PLOSS  = 0.9999f;
+constexpr float AIR_STILL  = 1e-4f; // pressure and velocity below this count as still air
+constexpr int AIR_FREEZE_TICKS = 30;
 
 constexpr int NGOL = 24;
 
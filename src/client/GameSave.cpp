@@ -17,7 +17,7 @@
 #include <algorithm>
 
 constexpr auto currentVersion   = UPSTREAM_VERSION.displayVersion;
-constexpr auto nextVersion      = Version(98, 0);
+constexpr auto nextVersion      = Version(99, 0);
 constexpr auto effectiveVersion = ALLOW_FAKE_NEWER_VERSION ? nextVersion : currentVersion;
 
 static void ConvertJsonToBson(bson *b, Json::Value j, int depth = 0);
@@ -537,6 +537,7 @@ void GameSave::readOPS(const std::vector<char> &data)
 		CheckBsonFieldFloat(iter, "customGravityX", &customGravityX);
 		CheckBsonFieldFloat(iter, "customGravityY", &customGravityY);
 		CheckBsonFieldInt(iter, "airMode", &airMode);
+		CheckBsonFieldInt(iter, "heatMode", &heatMode);
 		CheckBsonFieldFloat(iter, "ambientAirTemp", &ambientAirTemp);
 		CheckBsonFieldInt(iter, "edgeMode", &edgeMode);
 		CheckBsonFieldInt(iter, "pmapbits", &pmapbits);
@@ -2444,6 +2445,11 @@ std::pair<bool, std::vector<char>> GameSave::serialiseOPS() const
 	bson_append_bool(&b, "paused", paused);
 	bson_append_int(&b, "gravityMode", gravityMode);
 	bson_append_int(&b, "airMode", airMode);
+	if (heatMode)
+	{
+		bson_append_int(&b, "heatMode", heatMode);
+		RESTRICTVERSION(99, 0);
+	}
 	if (fabsf(ambientAirTemp - (R_TEMP + 273.15f)) > 0.0001f)
 	{
 		bson_append_double(&b, "ambientAirTemp", double(ambientAirTemp));
@@ -100,6 +100,7 @@ public:
 	float customGravityX = 0.0f;
 	float customGravityY = 0.0f;
 	int airMode = 0;
+	int heatMode = 0;
 	float ambientAirTemp = R_TEMP + 273.15f;
 	int edgeMode = 0;
 	bool wantAuthors = true;
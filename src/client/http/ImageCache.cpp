@@ -0,0 +1,62 @@
+#include "ImageCache.h"
+#include "graphics/Graphics.h"
+#include "Config.h"
+
+namespace http
+{
+	ImageCache &ImageCache::Ref()
+	{
+		static ImageCache instance;
+		return instance;
+	}
+
+	std::unique_ptr<VideoBuffer> ImageCache::Get(const ByteString &url, Vec2<int> size)
+	{
+		auto it = index.find({ url, size });
+		if (it == index.end())
+		{
+			return nullptr;
+		}
+		items.splice(items.begin(), items, it->second);
+		return std::make_unique<VideoBuffer>(*it->second->image);
+	}
+
+	void ImageCache::Put(const ByteString &url, Vec2<int> size, const VideoBuffer &image)
+	{
+		auto bytes = int64_t(image.Size().X) * image.Size().Y * sizeof(pixel);
+		if (bytes > imageCacheMaxBytes / 8)
+		{
+			return;
+		}
+		Key key{ url, size };
+		auto it = index.find(key);
+		if (it != index.end())
+		{
+			totalBytes -= it->second->bytes;
+			items.erase(it->second);
+			index.erase(it);
+		}
+		items.push_front({ key, std::make_unique<VideoBuffer>(image), bytes });
+		index[key] = items.begin();
+		totalBytes += bytes;
+		Evict();
+	}
+
+	void ImageCache::Clear()
+	{
+		index.clear();
+		items.clear();
+		totalBytes = 0;
+	}
+
+	void ImageCache::Evict()
+	{
+		while (totalBytes > imageCacheMaxBytes && !items.empty())
+		{
+			auto &oldest = items.back();
+			totalBytes -= oldest.bytes;
+			index.erase(oldest.key);
+			items.pop_back();
+		}
+	}
+}
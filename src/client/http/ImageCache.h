@@ -0,0 +1,57 @@
+#pragma once
+#include "common/String.h"
+#include "common/Vec2.h"
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+
+class VideoBuffer;
+
+namespace http
+{
+	// Process-wide cache of decoded and resized images (save thumbnails, avatars), so that browsing
+	// back and forth between views does not decode the same PNG over and over. Keyed by URL and
+	// target size; save thumbnail URLs already include the save ID and version. Least recently used
+	// entries are dropped once the cache grows beyond imageCacheMaxBytes. Main thread only.
+	class ImageCache
+	{
+		struct Key
+		{
+			ByteString url;
+			Vec2<int> size;
+
+			bool operator <(const Key &other) const
+			{
+				if (url != other.url)
+				{
+					return url < other.url;
+				}
+				if (size.X != other.size.X)
+				{
+					return size.X < other.size.X;
+				}
+				return size.Y < other.size.Y;
+			}
+		};
+		struct Item
+		{
+			Key key;
+			std::unique_ptr<VideoBuffer> image;
+			int64_t bytes;
+		};
+		std::list<Item> items; // most recently used first
+		std::map<Key, std::list<Item>::iterator> index;
+		int64_t totalBytes = 0;
+
+		void Evict();
+
+	public:
+		static ImageCache &Ref();
+
+		// Returns a copy of the cached image or nullptr on a miss.
+		std::unique_ptr<VideoBuffer> Get(const ByteString &url, Vec2<int> size);
+		void Put(const ByteString &url, Vec2<int> size, const VideoBuffer &image);
+		void Clear();
+	};
+}
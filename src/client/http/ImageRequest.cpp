@@ -1,11 +1,12 @@
 #include "ImageRequest.h"
+#include "ImageCache.h"
 #include "graphics/Graphics.h"
 #include "client/Client.h"
 #include <iostream>
 
 namespace http
 {
-	ImageRequest::ImageRequest(ByteString url, Vec2<int> newRequestedSize) : Request(url), requestedSize(newRequestedSize)
+	ImageRequest::ImageRequest(ByteString newUrl, Vec2<int> newRequestedSize) : Request(newUrl), url(newUrl), requestedSize(newRequestedSize)
 	{
 	}
 
@@ -17,6 +18,7 @@ namespace http
 		if (vb)
 		{
 			vb->Resize(requestedSize, true);
+			ImageCache::Ref().Put(url, requestedSize, *vb);
 		}
 		else
 		{
@@ -25,5 +27,10 @@ namespace http
 		}
 		return vb;
 	}
+
+	std::unique_ptr<VideoBuffer> ImageRequest::Cached(const ByteString &url, Vec2<int> size)
+	{
+		return ImageCache::Ref().Get(url, size);
+	}
 }
 
@@ -10,11 +10,15 @@ namespace http
 {
 	class ImageRequest : public Request
 	{
+		ByteString url;
 		Vec2<int> requestedSize;
 
 	public:
-		ImageRequest(ByteString url, Vec2<int> newRequestedSize);
+		ImageRequest(ByteString newUrl, Vec2<int> newRequestedSize);
 
 		std::unique_ptr<VideoBuffer> Finish();
+
+		// Already decoded image for this URL and size, if any; callers can skip the request entirely.
+		static std::unique_ptr<VideoBuffer> Cached(const ByteString &url, Vec2<int> size);
 	};
 }
@@ -4,12 +4,15 @@
 namespace http
 {
 	ThumbnailRequest::ThumbnailRequest(int saveID, int saveDate, Vec2<int> size) :
-		ImageRequest((
-			saveDate
-			? ByteString::Build(STATICSCHEME, STATICSERVER, "/", saveID, "_", saveDate, "_small.png")
-			: ByteString::Build(STATICSCHEME, STATICSERVER, "/", saveID, "_small.png")
-		), size)
+		ImageRequest(Url(saveID, saveDate), size)
 	{
 	}
+
+	ByteString ThumbnailRequest::Url(int saveID, int saveDate)
+	{
+		return saveDate
+			? ByteString::Build(STATICSCHEME, STATICSERVER, "/", saveID, "_", saveDate, "_small.png")
+			: ByteString::Build(STATICSCHEME, STATICSERVER, "/", saveID, "_small.png");
+	}
 }
 
@@ -7,5 +7,7 @@ namespace http
 	{
 	public:
 		ThumbnailRequest(int saveID, int saveDate, Vec2<int> size);
+
+		static ByteString Url(int saveID, int saveDate);
 	};
 }
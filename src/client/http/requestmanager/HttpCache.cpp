@@ -0,0 +1,248 @@
+#include "HttpCache.h"
+#include "common/platform/Platform.h"
+#include "Config.h"
+#include <fstream>
+#include <iostream>
+
+namespace http
+{
+	constexpr char cacheMagic[] = "TPTHTTPCACHE1";
+	constexpr char cacheExtension[] = ".http";
+
+	HttpCache::HttpCache(ByteString newDirectory, int64_t newMaxBytes) : directory(newDirectory), maxBytes(newMaxBytes)
+	{
+	}
+
+	void HttpCache::Init()
+	{
+		if (initialized)
+		{
+			return;
+		}
+		initialized = true;
+		Platform::MakeDirectory(directory);
+		for (auto &fileName : Platform::DirectorySearch(directory, "", { cacheExtension }))
+		{
+			std::ifstream file(directory + PATH_SEP_CHAR + fileName, std::ios::binary | std::ios::ate);
+			if (file)
+			{
+				Touch(fileName, int64_t(file.tellg()));
+			}
+		}
+		// older entries are not ordered among themselves, they only need to go before anything used in this session
+		for (auto &item : index)
+		{
+			item.second.lastUse = 0;
+		}
+		Evict();
+	}
+
+	ByteString HttpCache::FileName(const ByteString &uri) const
+	{
+		// http://www.isthe.com/chongo/tech/comp/fnv/
+		uint64_t hash = UINT64_C(14695981039346656037);
+		for (auto ch : uri)
+		{
+			hash ^= uint8_t(ch);
+			hash *= UINT64_C(1099511628211);
+		}
+		return ByteString::Build(Format::Hex(), Format::Width(16), Format::Fill('0'), hash, cacheExtension);
+	}
+
+	void HttpCache::Touch(const ByteString &fileName, int64_t size)
+	{
+		auto it = index.find(fileName);
+		if (it != index.end())
+		{
+			totalBytes -= it->second.size;
+		}
+		index[fileName] = { size, ++useCounter };
+		totalBytes += size;
+	}
+
+	void HttpCache::Evict()
+	{
+		while (totalBytes > maxBytes && !index.empty())
+		{
+			auto oldest = index.begin();
+			for (auto it = index.begin(); it != index.end(); ++it)
+			{
+				if (it->second.lastUse < oldest->second.lastUse)
+				{
+					oldest = it;
+				}
+			}
+			Platform::RemoveFile(directory + PATH_SEP_CHAR + oldest->first);
+			totalBytes -= oldest->second.size;
+			index.erase(oldest);
+		}
+	}
+
+	std::optional<HttpCache::Entry> HttpCache::Load(const ByteString &uri)
+	{
+		Init();
+		auto fileName = FileName(uri);
+		if (index.find(fileName) == index.end())
+		{
+			return std::nullopt;
+		}
+		auto path = directory + PATH_SEP_CHAR + fileName;
+		std::vector<char> fileData;
+		if (!Platform::ReadFile(fileData, path))
+		{
+			return std::nullopt;
+		}
+		auto bad = [this, &fileName, &path]() -> std::optional<Entry> {
+			std::cerr << "discarding malformed cache entry " << path << std::endl;
+			Platform::RemoveFile(path);
+			totalBytes -= index[fileName].size;
+			index.erase(fileName);
+			return std::nullopt;
+		};
+		size_t pos = 0;
+		auto nextLine = [&fileData, &pos]() -> std::optional<ByteString> {
+			auto begin = pos;
+			while (pos < fileData.size() && fileData[pos] != '\n')
+			{
+				pos += 1;
+			}
+			if (pos == fileData.size())
+			{
+				return std::nullopt;
+			}
+			pos += 1;
+			return ByteString(fileData.begin() + begin, fileData.begin() + pos - 1);
+		};
+		auto magic = nextLine();
+		auto entryUri = nextLine();
+		auto etag = nextLine();
+		auto lastModified = nextLine();
+		auto storedAt = nextLine();
+		auto maxAge = nextLine();
+		auto headerCount = nextLine();
+		if (!headerCount || *magic != cacheMagic)
+		{
+			return bad();
+		}
+		if (*entryUri != uri)
+		{
+			// hash collision, treat as a miss; the entry will be overwritten if this response is stored
+			return std::nullopt;
+		}
+		Entry entry;
+		entry.uri = *entryUri;
+		entry.etag = *etag;
+		entry.lastModified = *lastModified;
+		try
+		{
+			entry.storedAt = storedAt->ToNumber<int64_t>();
+			entry.maxAge = maxAge->ToNumber<int64_t>();
+			auto headers = headerCount->ToNumber<int>();
+			for (int i = 0; i < headers; ++i)
+			{
+				auto line = nextLine();
+				if (!line)
+				{
+					return bad();
+				}
+				auto split = line->SplitBy('\t');
+				if (!split)
+				{
+					return bad();
+				}
+				entry.headers.push_back({ split.Before(), split.After() });
+			}
+			auto dataSize = nextLine();
+			if (!dataSize || dataSize->ToNumber<size_t>() != fileData.size() - pos)
+			{
+				return bad();
+			}
+		}
+		catch (const std::runtime_error &)
+		{
+			return bad();
+		}
+		entry.data = ByteString(fileData.begin() + pos, fileData.end());
+		Touch(fileName, int64_t(fileData.size()));
+		return entry;
+	}
+
+	void HttpCache::Store(const Entry &entry)
+	{
+		Init();
+		ByteStringBuilder sb;
+		sb << cacheMagic << "\n";
+		sb << entry.uri << "\n";
+		sb << entry.etag << "\n";
+		sb << entry.lastModified << "\n";
+		sb << entry.storedAt << "\n";
+		sb << entry.maxAge << "\n";
+		sb << int(entry.headers.size()) << "\n";
+		for (auto &header : entry.headers)
+		{
+			sb << header.name << "\t" << header.value << "\n";
+		}
+		sb << entry.data.size() << "\n";
+		sb << entry.data;
+		auto serialized = sb.Build();
+		if (int64_t(serialized.size()) > maxBytes / 8)
+		{
+			return;
+		}
+		auto fileName = FileName(entry.uri);
+		if (!Platform::WriteFile(std::vector<char>(serialized.begin(), serialized.end()), directory + PATH_SEP_CHAR + fileName))
+		{
+			return;
+		}
+		Touch(fileName, int64_t(serialized.size()));
+		Evict();
+	}
+
+	bool HttpCache::Describe(Entry &entry, int64_t now)
+	{
+		entry.storedAt = now;
+		entry.maxAge = 0;
+		entry.etag.clear();
+		entry.lastModified.clear();
+		for (auto &header : entry.headers)
+		{
+			// header names are lowercased by the request manager
+			if (header.name == "etag")
+			{
+				entry.etag = header.value;
+			}
+			else if (header.name == "last-modified")
+			{
+				entry.lastModified = header.value;
+			}
+			else if (header.name == "cache-control")
+			{
+				auto value = header.value.ToLower();
+				if (value.Contains("no-store") || value.Contains("private"))
+				{
+					return false;
+				}
+				if (value.Contains("no-cache"))
+				{
+					entry.maxAge = 0;
+					continue;
+				}
+				auto maxAgeAt = value.find("max-age=");
+				if (maxAgeAt != value.npos)
+				{
+					auto begin = maxAgeAt + 8;
+					auto end = begin;
+					while (end < value.size() && value[end] >= '0' && value[end] <= '9')
+					{
+						end += 1;
+					}
+					if (end > begin)
+					{
+						entry.maxAge = ByteString(value.begin() + begin, value.begin() + end).ToNumber<int64_t>(true);
+					}
+				}
+			}
+		}
+		return entry.etag.size() || entry.lastModified.size() || entry.maxAge > 0;
+	}
+}
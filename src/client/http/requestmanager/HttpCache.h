@@ -0,0 +1,62 @@
+#pragma once
+#include "common/String.h"
+#include "client/http/PostData.h"
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace http
+{
+	// Disk-backed cache of GET responses, keyed by URI. Entries are only stored if the server sent
+	// something to revalidate them with (ETag or Last-Modified) or an explicit max-age. Not thread-safe,
+	// meant to be used from the request manager's worker thread only.
+	class HttpCache
+	{
+	public:
+		struct Entry
+		{
+			ByteString uri;
+			ByteString etag;
+			ByteString lastModified;
+			int64_t storedAt = 0; // unix time
+			int64_t maxAge = 0; // seconds the entry may be used without revalidation
+			std::vector<Header> headers;
+			ByteString data;
+
+			bool Fresh(int64_t now) const
+			{
+				return now >= storedAt && now < storedAt + maxAge;
+			}
+		};
+
+	private:
+		ByteString directory;
+		int64_t maxBytes;
+		int64_t totalBytes = 0;
+		uint64_t useCounter = 0;
+		bool initialized = false;
+		struct IndexItem
+		{
+			int64_t size;
+			uint64_t lastUse;
+		};
+		std::map<ByteString, IndexItem> index; // file name -> size and recency
+
+		void Init();
+		ByteString FileName(const ByteString &uri) const;
+		void Touch(const ByteString &fileName, int64_t size);
+		void Evict();
+
+	public:
+		HttpCache(ByteString newDirectory, int64_t newMaxBytes);
+
+		std::optional<Entry> Load(const ByteString &uri);
+		void Store(const Entry &entry);
+
+		// Fills in etag, lastModified and maxAge from response headers; returns false if the response
+		// must not be stored at all.
+		static bool Describe(Entry &entry, int64_t now);
+	};
+}
@@ -2,8 +2,11 @@
 #include "RequestManager.h"
 #include "client/http/Request.h"
 #include "CurlError.h"
+#include "HttpCache.h"
 #include "Config.h"
+#include <ctime>
 #include <iostream>
+#include <map>
 
 #if defined(CURL_AT_LEAST_VERSION) && CURL_AT_LEAST_VERSION(7, 55, 0)
 # define REQUEST_USE_CURL_OFFSET_T
@@ -64,6 +67,12 @@ namespace http
 		bool curlAddedToMulti = false;
 		bool gotStatusLine = false;
 
+		// See RequestManagerImpl::CacheBegin.
+		bool cacheable = false;
+		std::optional<HttpCache::Entry> cachedEntry; // being revalidated
+		RequestHandleHttp *leader = nullptr; // identical request in flight, this one gets a copy of its response
+		std::vector<std::shared_ptr<RequestHandle>> followers;
+
 		RequestHandleHttp() : RequestHandle(CtorTag{})
 		{
 		}
@@ -141,6 +150,11 @@ namespace http
 		bool curlGlobalInit = false;
 		CURLM *curlMulti = NULL;
 
+		HttpCache cache{ HTTP_CACHE_DIR, httpCacheMaxBytes };
+		std::map<ByteString, RequestHandleHttp *> inFlight; // cacheable requests with a transfer, by uri
+		bool CacheBegin(std::shared_ptr<RequestHandle> requestHandle);
+		void CacheEnd(RequestHandleHttp *handle);
+
 		void Wake()
 		{
 #ifdef REQUEST_USE_CURL_MULTI_POLL
@@ -255,6 +269,7 @@ namespace http
 				{
 					handle->error = handle->curlErrorBuffer;
 				}
+				CacheEnd(handle);
 			}
 		}
 		for (auto &requestHandle : requestHandles)
@@ -308,29 +323,39 @@ namespace http
 				requestHandlesToRegister.clear();
 				// Then unregister done handles. As explained above, registering a new handle may also immediately mark
 				// it done and we won't be coming back here until Wait() returns, so this has to come second.
-				for (auto &requestHandle : requestHandles)
+				// Unregistering a handle may in turn complete handles that were waiting for the same response, so
+				// repeat until there's nothing left to unregister.
+				while (true)
 				{
-					if (requestHandle->statusCode)
+					for (auto &requestHandle : requestHandles)
 					{
-						requestHandlesToUnregister.push_back(requestHandle);
+						if (requestHandle->statusCode)
+						{
+							requestHandlesToUnregister.push_back(requestHandle);
+						}
 					}
-				}
-				// Actually unregister handles queued to be unregistered. They can be queued just above, or from another thread.
-				// Thus, it's ok for them to be in the queue multiple times, but it's not ok to try to unregister them multiple times.
-				for (auto &requestHandle : requestHandlesToUnregister)
-				{
-					auto eraseFrom = std::remove(requestHandles.begin(), requestHandles.end(), requestHandle);
-					// Must either not be present
-					if (eraseFrom != requestHandles.end())
+					if (requestHandlesToUnregister.empty())
 					{
-						// Or be present exactly once
-						assert(eraseFrom + 1 == requestHandles.end());
-						UnregisterRequestHandle(requestHandle);
-						requestHandles.erase(eraseFrom, requestHandles.end());
-						requestHandle->MarkDone();
+						break;
+					}
+					// Actually unregister handles queued to be unregistered. They can be queued just above, or from another thread.
+					// Thus, it's ok for them to be in the queue multiple times, but it's not ok to try to unregister them multiple times.
+					auto toUnregister = std::move(requestHandlesToUnregister);
+					requestHandlesToUnregister.clear();
+					for (auto &requestHandle : toUnregister)
+					{
+						auto eraseFrom = std::remove(requestHandles.begin(), requestHandles.end(), requestHandle);
+						// Must either not be present
+						if (eraseFrom != requestHandles.end())
+						{
+							// Or be present exactly once
+							assert(eraseFrom + 1 == requestHandles.end());
+							requestHandles.erase(eraseFrom, requestHandles.end());
+							UnregisterRequestHandle(requestHandle);
+							requestHandle->MarkDone();
+						}
 					}
 				}
-				requestHandlesToUnregister.clear();
 				if (!running)
 				{
 					break;
@@ -378,6 +403,10 @@ namespace http
 		{
 			return failEarly(600, "no CURL multi handle");
 		}
+		if (CacheBegin(requestHandle))
+		{
+			return;
+		}
 		try
 		{
 			handle->curlEasy = curl_easy_init();
@@ -524,12 +553,145 @@ namespace http
 			handle->curlAddedToMulti = false;
 		}
 		curl_easy_cleanup(handle->curlEasy);
+		handle->curlEasy = NULL;
 #ifdef REQUEST_USE_CURL_MIMEPOST
 		curl_mime_free(handle->curlPostFields);
+		handle->curlPostFields = NULL;
 #else
 		curl_formfree(handle->curlPostFieldsFirst);
+		handle->curlPostFieldsFirst = NULL;
+		handle->curlPostFieldsLast = NULL;
 #endif
 		curl_slist_free_all(handle->curlHeaders);
+		handle->curlHeaders = NULL;
+		if (handle->leader)
+		{
+			// Cancelled while waiting for an identical request.
+			auto &followers = handle->leader->followers;
+			followers.erase(std::remove(followers.begin(), followers.end(), requestHandle), followers.end());
+			handle->leader = nullptr;
+		}
+		auto it = inFlight.find(handle->uri);
+		if (it != inFlight.end() && it->second == handle)
+		{
+			inFlight.erase(it);
+		}
+		auto followers = std::move(handle->followers);
+		handle->followers.clear();
+		if (followers.empty())
+		{
+			return;
+		}
+		if (handle->statusCode)
+		{
+			for (auto &followerHandle : followers)
+			{
+				auto follower = static_cast<RequestHandleHttp *>(followerHandle.get());
+				follower->leader = nullptr;
+				follower->responseHeaders = handle->responseHeaders;
+				follower->responseData = handle->responseData;
+				follower->error = handle->error;
+				follower->statusCode = handle->statusCode;
+			}
+			return;
+		}
+		// Cancelled before finishing, hand the transfer over to the first follower.
+		auto promoted = static_cast<RequestHandleHttp *>(followers.front().get());
+		promoted->leader = nullptr;
+		RegisterRequestHandle(followers.front());
+		for (auto i = 1U; i < followers.size(); ++i)
+		{
+			static_cast<RequestHandleHttp *>(followers[i].get())->leader = promoted;
+			promoted->followers.push_back(followers[i]);
+		}
+	}
+
+	// Returns true if the request doesn't need a transfer of its own, either because it can be served
+	// from the cache, or because an identical request is already in flight.
+	bool RequestManagerImpl::CacheBegin(std::shared_ptr<RequestHandle> requestHandle)
+	{
+		auto handle = static_cast<RequestHandleHttp *>(requestHandle.get());
+		// Only plain GETs; custom headers may change the response in ways the uri doesn't capture.
+		handle->cacheable = !handle->isPost && !handle->verb && handle->headers.empty();
+		if (!handle->cacheable)
+		{
+			return false;
+		}
+		auto it = inFlight.find(handle->uri);
+		if (it != inFlight.end())
+		{
+			handle->leader = it->second;
+			it->second->followers.push_back(requestHandle);
+			return true;
+		}
+		if (auto entry = cache.Load(handle->uri))
+		{
+			if (entry->Fresh(int64_t(std::time(nullptr))))
+			{
+				handle->responseHeaders = entry->headers;
+				handle->responseData = entry->data;
+				handle->statusCode = 200;
+				return true;
+			}
+			if (entry->etag.size())
+			{
+				handle->headers.push_back({ "If-None-Match", entry->etag });
+			}
+			if (entry->lastModified.size())
+			{
+				handle->headers.push_back({ "If-Modified-Since", entry->lastModified });
+			}
+			handle->cachedEntry = std::move(entry);
+		}
+		inFlight[handle->uri] = handle;
+		return false;
+	}
+
+	void RequestManagerImpl::CacheEnd(RequestHandleHttp *handle)
+	{
+		if (!handle->cacheable || handle->error)
+		{
+			return;
+		}
+		auto now = int64_t(std::time(nullptr));
+		if (handle->statusCode == 304 && handle->cachedEntry)
+		{
+			// Not modified; headers sent with a 304 replace the stored ones, the body stays the same.
+			auto entry = std::move(*handle->cachedEntry);
+			for (auto &header : handle->responseHeaders)
+			{
+				auto stored = std::find_if(entry.headers.begin(), entry.headers.end(), [&header](auto &item) {
+					return item.name == header.name;
+				});
+				if (stored != entry.headers.end())
+				{
+					stored->value = header.value;
+				}
+				else
+				{
+					entry.headers.push_back(header);
+				}
+			}
+			if (HttpCache::Describe(entry, now))
+			{
+				cache.Store(entry);
+			}
+			handle->responseHeaders = std::move(entry.headers);
+			handle->responseData = std::move(entry.data);
+			handle->statusCode = 200;
+		}
+		else if (handle->statusCode == 200)
+		{
+			HttpCache::Entry entry;
+			entry.uri = handle->uri;
+			entry.headers = handle->responseHeaders;
+			entry.data = handle->responseData;
+			if (HttpCache::Describe(entry, now))
+			{
+				cache.Store(entry);
+			}
+		}
+		handle->cachedEntry.reset();
 	}
 
 	RequestManagerPtr RequestManager::Create(ByteString newProxy, ByteString newCafile, ByteString newCapath, bool newDisableNetwork)
@@ -0,0 +1,104 @@
+#include "ForEachBand.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	class BandPool
+	{
+		std::mutex runMx; // held by the thread whose bands are being run
+		std::mutex mx;
+		std::condition_variable work;
+		std::condition_variable done;
+		std::vector<std::thread> workers;
+		bool quit = false;
+		uint64_t generation = 0;
+		int pending = 0;
+		ForEachBandDetail::BandFunction function = nullptr;
+		void *context = nullptr;
+		int bands = 0;
+		int count = 0;
+
+		void Work(int band)
+		{
+			uint64_t seen = 0;
+			std::unique_lock lk(mx);
+			while (true)
+			{
+				work.wait(lk, [this, &seen]() {
+					return quit || generation != seen;
+				});
+				if (quit)
+				{
+					return;
+				}
+				seen = generation;
+				if (band >= bands)
+				{
+					continue;
+				}
+				auto begin = count * band / bands;
+				auto end = count * (band + 1) / bands;
+				lk.unlock();
+				function(context, band, begin, end);
+				lk.lock();
+				pending -= 1;
+				if (!pending)
+				{
+					done.notify_one();
+				}
+			}
+		}
+
+	public:
+		~BandPool()
+		{
+			{
+				std::unique_lock lk(mx);
+				quit = true;
+			}
+			work.notify_all();
+			for (auto &worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		bool Run(ForEachBandDetail::BandFunction newFunction, void *newContext, int newBands, int newCount)
+		{
+			std::unique_lock runLk(runMx, std::try_to_lock);
+			if (!runLk.owns_lock())
+			{
+				return false;
+			}
+			{
+				std::unique_lock lk(mx);
+				while (int(workers.size()) < newBands - 1)
+				{
+					workers.emplace_back(&BandPool::Work, this, int(workers.size()) + 1);
+				}
+				function = newFunction;
+				context = newContext;
+				bands = newBands;
+				count = newCount;
+				pending = newBands - 1;
+				generation += 1;
+			}
+			work.notify_all();
+			newFunction(newContext, 0, 0, newCount / newBands);
+			std::unique_lock lk(mx);
+			done.wait(lk, [this]() {
+				return !pending;
+			});
+			return true;
+		}
+	};
+}
+
+bool ForEachBandDetail::RunOnPool(BandFunction function, void *context, int bands, int count)
+{
+	static BandPool pool;
+	return pool.Run(function, context, bands, count);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Config.h"
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+constexpr int maxBands = 8;
+
+namespace ForEachBandDetail
+{
+	using BandFunction = void (*)(void *context, int band, int begin, int end);
+
+	// Runs function for every band, band 0 on the calling thread and the rest on a pool
+	// of worker threads that is started on first use and kept around for later calls.
+	// Returns false without running anything if the pool is busy with another thread's bands.
+	bool RunOnPool(BandFunction function, void *context, int bands, int count);
+}
+
+// Splits [0, count) into at most maxBands bands of at least minBand items and calls
+// body(band, begin, end) for each, on worker threads if SIM_THREADS allows it. body must
+// only write state that belongs to its own band.
+template<class Body>
+void ForEachBand(int count, int minBand, Body &&body)
+{
+	auto bands = 1;
+	if constexpr (SIM_THREADS)
+	{
+		bands = std::clamp(std::min(int(std::thread::hardware_concurrency()), count / minBand), 1, maxBands);
+	}
+	if (bands == 1)
+	{
+		body(0, 0, count);
+		return;
+	}
+	using BodyType = std::remove_reference_t<Body>;
+	auto *context = const_cast<void *>(static_cast<const void *>(std::addressof(body)));
+	auto function = [](void *context, int band, int begin, int end) {
+		(*static_cast<BodyType *>(context))(band, begin, end);
+	};
+	if (!ForEachBandDetail::RunOnPool(function, context, bands, count))
+	{
+		// same bands as on the pool, so the results don't depend on who got to it first
+		for (auto band = 0; band < bands; band++)
+		{
+			body(band, count * band / bands, count * (band + 1) / bands);
+		}
+	}
+}
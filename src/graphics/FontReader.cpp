@@ -4,7 +4,10 @@
 #include "font.bz2.h"
 
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 
 unsigned char *font_data = nullptr;
 unsigned int *font_ptrs = nullptr;
@@ -126,3 +129,49 @@ int FontReader::NextPixel()
 	data >>= 2;
 	return old & 0x3;
 }
+
+struct GlyphPage
+{
+	std::array<uint8_t, 256> widths;
+	std::array<uint32_t, 256> offsets;
+	std::vector<uint8_t> pixels;
+};
+constexpr int glyphPageCount = 0x110000 / 256;
+// pages are read without taking the lock, Renderer threads other than the main one also draw text
+static std::array<std::atomic<GlyphPage const *>, glyphPageCount> glyphPages{};
+static std::array<std::unique_ptr<GlyphPage>, glyphPageCount> ownedGlyphPages;
+static std::mutex glyphPagesMx;
+
+FontGlyph FontGlyph::Get(String::value_type ch)
+{
+	if (ch >= 0x110000)
+	{
+		ch = 0xFFFD;
+	}
+	auto &slot = glyphPages[ch >> 8];
+	auto *page = slot.load(std::memory_order_acquire);
+	if (!page)
+	{
+		std::lock_guard lk(glyphPagesMx);
+		page = slot.load(std::memory_order_relaxed);
+		if (!page)
+		{
+			auto newPage = std::make_unique<GlyphPage>();
+			for (int i = 0; i < 256; i++)
+			{
+				FontReader reader(String::value_type((ch & ~0xFFU) | i));
+				newPage->widths[i] = uint8_t(reader.GetWidth());
+				newPage->offsets[i] = uint32_t(newPage->pixels.size());
+				for (int j = 0; j < reader.GetWidth() * FONT_H; j++)
+				{
+					newPage->pixels.push_back(uint8_t(reader.NextPixel()));
+				}
+			}
+			page = newPage.get();
+			ownedGlyphPages[ch >> 8] = std::move(newPage);
+			slot.store(page, std::memory_order_release);
+		}
+	}
+	auto index = ch & 0xFFU;
+	return { page->widths[index], page->pixels.data() + page->offsets[index] };
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 
 #include "common/String.h"
 
@@ -20,3 +21,14 @@ public:
 	int GetWidth() const;
 	int NextPixel();
 };
+
+// A glyph expanded to one byte per pixel, FONT_H rows of width pixels each, with the values
+// NextPixel would return. Expanded 256 code points at a time on first use and kept around, so
+// drawing text and measuring it does not decode the font again.
+struct FontGlyph
+{
+	int width;
+	uint8_t const *pixels;
+
+	static FontGlyph Get(String::value_type ch);
+};
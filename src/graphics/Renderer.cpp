@@ -143,8 +143,8 @@ std::unique_ptr<VideoBuffer> Renderer::WallIcon(int wallID, Vec2<int> size)
 void Renderer::DrawSigns()
 {
 	int x, y, w, h;
-	std::vector<sign> signs = sim->signs;
-	for (auto &currentSign : signs)
+	// by reference, so that signs keep their cached display text between frames
+	for (auto &currentSign : sim->signs)
 	{
 		if (currentSign.text.length())
 		{
@@ -864,76 +864,200 @@ void Renderer::draw_air()
 		return;
 	if(!(display_mode & DISPLAY_AIR))
 		return;
-	int x, y, i, j;
 	float (*pv)[XCELLS] = sim->air->pv;
 	float (*hv)[XCELLS] = sim->air->hv;
 	float (*vx)[XCELLS] = sim->air->vx;
 	float (*vy)[XCELLS] = sim->air->vy;
-	auto c = 0x000000_rgb;
-	for (y=0; y<YCELLS; y++)
-		for (x=0; x<XCELLS; x++)
+	// The display mode is resolved once per frame rather than once per cell; each
+	// row of cells is coloured into a buffer and then stretched into CELL rows of pixels.
+	auto drawRows = [this](auto cellColour) {
+		std::array<pixel, XCELLS> cells;
+		for (int y = 0; y < YCELLS; y++)
 		{
-			if (display_mode & DISPLAY_AIRP)
+			for (int x = 0; x < XCELLS; x++)
 			{
-				if (pv[y][x] > 0.0f)
-					c = RGB<uint8_t>(clamp_flt(pv[y][x], 0.0f, 8.0f), 0, 0);//positive pressure is red!
-				else
-					c = RGB<uint8_t>(0, 0, clamp_flt(-pv[y][x], 0.0f, 8.0f));//negative pressure is blue!
-			}
-			else if (display_mode & DISPLAY_AIRV)
-			{
-				c = RGB<uint8_t>(clamp_flt(fabsf(vx[y][x]), 0.0f, 8.0f),//vx adds red
-					clamp_flt(pv[y][x], 0.0f, 8.0f),//pressure adds green
-					clamp_flt(fabsf(vy[y][x]), 0.0f, 8.0f));//vy adds blue
+				auto c = cellColour(y, x);
+				if (findingElement)
+				{
+					c.Red   /= 10;
+					c.Green /= 10;
+					c.Blue  /= 10;
+				}
+				cells[x] = c.Pack();
 			}
-			else if (display_mode & DISPLAY_AIRH)
+			auto *row = &*video.RowIterator({ 0, y * CELL });
+			for (int x = 0; x < XCELLS; x++)//draws the colors
+				std::fill_n(row + x * CELL, CELL, cells[x]);
+			for (int j = 1; j < CELL; j++)
+				std::copy_n(row, XCELLS * CELL, &*video.RowIterator({ 0, y * CELL + j }));
+		}
+	};
+	if (display_mode & DISPLAY_AIRP)
+	{
+		drawRows([pv](int y, int x) {
+			if (pv[y][x] > 0.0f)
+				return RGB<uint8_t>(clamp_flt(pv[y][x], 0.0f, 8.0f), 0, 0);//positive pressure is red!
+			return RGB<uint8_t>(0, 0, clamp_flt(-pv[y][x], 0.0f, 8.0f));//negative pressure is blue!
+		});
+	}
+	else if (display_mode & DISPLAY_AIRV)
+	{
+		drawRows([pv, vx, vy](int y, int x) {
+			return RGB<uint8_t>(clamp_flt(fabsf(vx[y][x]), 0.0f, 8.0f),//vx adds red
+				clamp_flt(pv[y][x], 0.0f, 8.0f),//pressure adds green
+				clamp_flt(fabsf(vy[y][x]), 0.0f, 8.0f));//vy adds blue
+		});
+	}
+	else if (display_mode & DISPLAY_AIRH)
+	{
+		drawRows([hv](int y, int x) {
+			return RGB<uint8_t>::Unpack(HeatToColour(hv[y][x]));
+		});
+	}
+	else if (display_mode & DISPLAY_AIRC)
+	{
+		drawRows([pv, vx, vy](int y, int x) {
+			// velocity adds grey
+			int r = clamp_flt(fabsf(vx[y][x]), 0.0f, 24.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 20.0f);
+			int g = clamp_flt(fabsf(vx[y][x]), 0.0f, 20.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 24.0f);
+			int b = clamp_flt(fabsf(vx[y][x]), 0.0f, 24.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 20.0f);
+			if (pv[y][x] > 0.0f)
+				r += clamp_flt(pv[y][x], 0.0f, 16.0f);//pressure adds red!
+			else
+				b += clamp_flt(-pv[y][x], 0.0f, 16.0f);//pressure adds blue!
+			return RGB<uint8_t>(std::min(r, 255), std::min(g, 255), std::min(b, 255));
+		});
+	}
+	else
+	{
+		drawRows([](int y, int x) {
+			return 0x000000_rgb;
+		});
+	}
+}
+
+void Renderer::BuildWallPatterns(bool dimmed)
+{
+	auto &sd = SimulationData::CRef();
+	auto &wtypes = sd.wtypes;
+	// Patterns are drawn for the cell at the origin, which only works because the patterns
+	// that depend on the position of the cell only depend on the parity of its pixels.
+	static_assert(CELL % 2 == 0);
+	wallPatternsDimmed = dimmed;
+	wallPatterns.resize(UI_WALLCOUNT);
+	for (int wt = 0; wt < UI_WALLCOUNT; wt++)
+		for (int powered = 0; powered < 2; powered++)
+		{
+			auto &pattern = wallPatterns[wt][powered];
+			std::array<pixel, CELL * CELL> colour{};
+			std::array<bool, CELL * CELL> covered{};
+			auto put = [&colour, &covered](int i, int j, pixel px) {
+				colour[j * CELL + i] = px;
+				covered[j * CELL + i] = true;
+			};
+			RGB<uint8_t> prgb = wtypes[wt].colour;
+			RGB<uint8_t> grgb = wtypes[wt].eglow;
+
+			if (dimmed)
 			{
-				c = RGB<uint8_t>::Unpack(HeatToColour(hv[y][x]));
-				//c = RGB<uint8_t>(clamp_flt(fabsf(vx[y][x]), 0.0f, 8.0f),//vx adds red
-				//	clamp_flt(hv[y][x], 0.0f, 1600.0f),//heat adds green
-				//	clamp_flt(fabsf(vy[y][x]), 0.0f, 8.0f)).Pack();//vy adds blue
+				prgb.Red   /= 10;
+				prgb.Green /= 10;
+				prgb.Blue  /= 10;
+				grgb.Red   /= 10;
+				grgb.Green /= 10;
+				grgb.Blue  /= 10;
 			}
-			else if (display_mode & DISPLAY_AIRC)
+
+			pixel pc = prgb.Pack();
+			pixel gc = grgb.Pack();
+
+			switch (wtypes[wt].drawstyle)
 			{
-				int r;
-				int g;
-				int b;
-				// velocity adds grey
-				r = clamp_flt(fabsf(vx[y][x]), 0.0f, 24.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 20.0f);
-				g = clamp_flt(fabsf(vx[y][x]), 0.0f, 20.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 24.0f);
-				b = clamp_flt(fabsf(vx[y][x]), 0.0f, 24.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 20.0f);
-				if (pv[y][x] > 0.0f)
+			case 0:
+				if (wt == WL_EWALL || wt == WL_STASIS)
 				{
-					r += clamp_flt(pv[y][x], 0.0f, 16.0f);//pressure adds red!
-					if (r>255)
-						r=255;
-					if (g>255)
-						g=255;
-					if (b>255)
-						b=255;
-					c = RGB<uint8_t>(r, g, b);
+					bool reverse = wt == WL_STASIS;
+					if (powered ^ reverse)
+					{
+						for (int j = 0; j < CELL; j++)
+							for (int i =0; i < CELL; i++)
+								if (i&j&1)
+									put(i, j, pc);
+					}
+					else
+					{
+						for (int j = 0; j < CELL; j++)
+							for (int i = 0; i < CELL; i++)
+								if (!(i&j&1))
+									put(i, j, pc);
+					}
 				}
-				else
+				else if (wt == WL_WALLELEC)
 				{
-					b += clamp_flt(-pv[y][x], 0.0f, 16.0f);//pressure adds blue!
-					if (r>255)
-						r=255;
-					if (g>255)
-						g=255;
-					if (b>255)
-						b=255;
-					c = RGB<uint8_t>(r, g, b);
+					for (int j = 0; j < CELL; j++)
+						for (int i = 0; i < CELL; i++)
+						{
+							if (!(j%2) && !(i%2))
+								put(i, j, pc);
+							else
+								put(i, j, 0x808080_rgb .Pack());
+						}
 				}
+				else if (wt == WL_EHOLE)
+				{
+					if (powered)
+					{
+						for (int j = 0; j < CELL; j++)
+							for (int i = 0; i < CELL; i++)
+								put(i, j, 0x242424_rgb .Pack());
+						for (int j = 0; j < CELL; j += 2)
+							for (int i = 0; i < CELL; i += 2)
+								put(i, j, 0x000000_rgb .Pack());
+					}
+					else
+					{
+						for (int j = 0; j < CELL; j += 2)
+							for (int i =0; i < CELL; i += 2)
+								put(i, j, 0x242424_rgb .Pack());
+					}
+				}
+				break;
+			case 1:
+				for (int j = 0; j < CELL; j += 2)
+					for (int i = (j>>1)&1; i < CELL; i += 2)
+						put(i, j, pc);
+				break;
+			case 2:
+				for (int j = 0; j < CELL; j += 2)
+					for (int i = 0; i < CELL; i += 2)
+						put(i, j, pc);
+				break;
+			case 3:
+				for (int j = 0; j < CELL; j++)
+					for (int i = 0; i < CELL; i++)
+						put(i, j, pc);
+				break;
+			case 4:
+				for (int j = 0; j < CELL; j++)
+					for (int i = 0; i < CELL; i++)
+						if (i == j)
+							put(i, j, pc);
+						else if (i == j+1 || (i == 0 && j == CELL-1))
+							put(i, j, gc);
+						else
+							put(i, j, 0x202020_rgb .Pack());
+				break;
 			}
-			if (findingElement)
-			{
-				c.Red   /= 10;
-				c.Green /= 10;
-				c.Blue  /= 10;
-			}
-			for (j=0; j<CELL; j++)//draws the colors
-				for (i=0; i<CELL; i++)
-					video[{ x * CELL + i, y * CELL + j }] = c.Pack();
+			pattern.count = 0;
+			for (int j = 0; j < CELL; j++)
+				for (int i = 0; i < CELL; i++)
+					if (covered[j * CELL + i])
+					{
+						pattern.offset[pattern.count] = j * WINDOWW + i;
+						pattern.colour[pattern.count] = colour[j * CELL + i];
+						pattern.count += 1;
+					}
+			pattern.opaque = pattern.count == CELL * CELL;
 		}
 }
 
@@ -941,6 +1065,10 @@ void Renderer::DrawWalls()
 {
 	auto &sd = SimulationData::CRef();
 	auto &wtypes = sd.wtypes;
+	if (wallPatternsDimmed != bool(findingElement))
+	{
+		BuildWallPatterns(bool(findingElement));
+	}
 	for (int y = 0; y < YCELLS; y++)
 		for (int x =0; x < XCELLS; x++)
 			if (sim->bmap[y][x])
@@ -949,146 +1077,81 @@ void Renderer::DrawWalls()
 				if (wt >= UI_WALLCOUNT)
 					continue;
 				unsigned char powered = sim->emap[y][x];
-				RGB<uint8_t> prgb = wtypes[wt].colour;
-				RGB<uint8_t> grgb = wtypes[wt].eglow;
-
-				if (findingElement)
+				auto &pattern = wallPatterns[wt][powered > 0];
+				auto *origin = &*video.RowIterator({ x * CELL, y * CELL });
+				if (pattern.opaque)
 				{
-					prgb.Red   /= 10;
-					prgb.Green /= 10;
-					prgb.Blue  /= 10;
-					grgb.Red   /= 10;
-					grgb.Green /= 10;
-					grgb.Blue  /= 10;
+					for (int j = 0; j < CELL; j++)
+						std::copy_n(&pattern.colour[j * CELL], CELL, origin + j * WINDOWW);
+				}
+				else
+				{
+					for (int k = 0; k < pattern.count; k++)
+						origin[pattern.offset[k]] = pattern.colour[k];
 				}
 
-				pixel pc = prgb.Pack();
-				pixel gc = grgb.Pack();
-
-				switch (wtypes[wt].drawstyle)
+				if (wt == WL_STREAM)
 				{
-				case 0:
-					if (wt == WL_EWALL || wt == WL_STASIS)
+					float xf = x*CELL + CELL*0.5f;
+					float yf = y*CELL + CELL*0.5f;
+					int oldX = (int)(xf+0.5f), oldY = (int)(yf+0.5f);
+					int newX, newY;
+					float xVel = sim->vx[y][x]*0.125f, yVel = sim->vy[y][x]*0.125f;
+					// there is no velocity here, draw a streamline and continue
+					if (!xVel && !yVel)
 					{
-						bool reverse = wt == WL_STASIS;
-						if ((powered > 0) ^ reverse)
-						{
-							for (int j = 0; j < CELL; j++)
-								for (int i =0; i < CELL; i++)
-									if (i&j&1)
-										video[{ x * CELL + i, y * CELL + j }] = pc;
-						}
-						else
-						{
-							for (int j = 0; j < CELL; j++)
-								for (int i = 0; i < CELL; i++)
-									if (!(i&j&1))
-										video[{ x * CELL + i, y * CELL + j }] = pc;
-						}
-					}
-					else if (wt == WL_WALLELEC)
-					{
-						for (int j = 0; j < CELL; j++)
-							for (int i = 0; i < CELL; i++)
-							{
-								if (!((y*CELL+j)%2) && !((x*CELL+i)%2))
-									video[{ x * CELL + i, y * CELL + j }] = pc;
-								else
-									video[{ x * CELL + i, y * CELL + j }] = 0x808080_rgb .Pack();
-							}
-					}
-					else if (wt == WL_EHOLE)
-					{
-						if (powered)
-						{
-							for (int j = 0; j < CELL; j++)
-								for (int i = 0; i < CELL; i++)
-									video[{ x * CELL + i, y * CELL + j }] = 0x242424_rgb .Pack();
-							for (int j = 0; j < CELL; j += 2)
-								for (int i = 0; i < CELL; i += 2)
-									video[{ x * CELL + i, y * CELL + j }] = 0x000000_rgb .Pack();
-						}
-						else
-						{
-							for (int j = 0; j < CELL; j += 2)
-								for (int i =0; i < CELL; i += 2)
-									video[{ x * CELL + i, y * CELL + j }] = 0x242424_rgb .Pack();
-						}
+						BlendText({ x*CELL, y*CELL-2 }, 0xE00D, 0xFFFFFF_rgb .WithAlpha(128));
+						AddPixel({ oldX, oldY }, 0xFFFFFF_rgb .WithAlpha(255));
+						continue;
 					}
-					else if (wt == WL_STREAM)
+					bool changed = false;
+					for (int t = 0; t < 1024; t++)
 					{
-						float xf = x*CELL + CELL*0.5f;
-						float yf = y*CELL + CELL*0.5f;
-						int oldX = (int)(xf+0.5f), oldY = (int)(yf+0.5f);
-						int newX, newY;
-						float xVel = sim->vx[y][x]*0.125f, yVel = sim->vy[y][x]*0.125f;
-						// there is no velocity here, draw a streamline and continue
-						if (!xVel && !yVel)
+						newX = (int)(xf+0.5f);
+						newY = (int)(yf+0.5f);
+						if (newX != oldX || newY != oldY)
 						{
-							BlendText({ x*CELL, y*CELL-2 }, 0xE00D, 0xFFFFFF_rgb .WithAlpha(128));
-							AddPixel({ oldX, oldY }, 0xFFFFFF_rgb .WithAlpha(255));
-							continue;
+							changed = true;
+							oldX = newX;
+							oldY = newY;
 						}
-						bool changed = false;
-						for (int t = 0; t < 1024; t++)
+						if (changed && (newX<0 || newX>=XRES || newY<0 || newY>=YRES))
+							break;
+						AddPixel({ newX, newY }, 0xFFFFFF_rgb .WithAlpha(64));
+						// cache velocity and other checks so we aren't running them constantly
+						if (changed)
 						{
-							newX = (int)(xf+0.5f);
-							newY = (int)(yf+0.5f);
-							if (newX != oldX || newY != oldY)
-							{
-								changed = true;
-								oldX = newX;
-								oldY = newY;
-							}
-							if (changed && (newX<0 || newX>=XRES || newY<0 || newY>=YRES))
+							int wallX = newX/CELL;
+							int wallY = newY/CELL;
+							xVel = sim->vx[wallY][wallX]*0.125f;
+							yVel = sim->vy[wallY][wallX]*0.125f;
+							if (wallX != x && wallY != y && sim->bmap[wallY][wallX] == WL_STREAM)
 								break;
-							AddPixel({ newX, newY }, 0xFFFFFF_rgb .WithAlpha(64));
-							// cache velocity and other checks so we aren't running them constantly
-							if (changed)
-							{
-								int wallX = newX/CELL;
-								int wallY = newY/CELL;
-								xVel = sim->vx[wallY][wallX]*0.125f;
-								yVel = sim->vy[wallY][wallX]*0.125f;
-								if (wallX != x && wallY != y && sim->bmap[wallY][wallX] == WL_STREAM)
-									break;
-							}
-							xf += xVel;
-							yf += yVel;
 						}
-						BlendText({ x*CELL, y*CELL-2 }, 0xE00D, 0xFFFFFF_rgb .WithAlpha(128));
+						xf += xVel;
+						yf += yVel;
 					}
-					break;
-				case 1:
-					for (int j = 0; j < CELL; j += 2)
-						for (int i = (j>>1)&1; i < CELL; i += 2)
-							video[{ x * CELL + i, y * CELL + j }] = pc;
-					break;
-				case 2:
-					for (int j = 0; j < CELL; j += 2)
-						for (int i = 0; i < CELL; i += 2)
-							video[{ x * CELL + i, y * CELL + j }] = pc;
-					break;
-				case 3:
-					for (int j = 0; j < CELL; j++)
-						for (int i = 0; i < CELL; i++)
-							video[{ x * CELL + i, y * CELL + j }] = pc;
-					break;
-				case 4:
-					for (int j = 0; j < CELL; j++)
-						for (int i = 0; i < CELL; i++)
-							if (i == j)
-								video[{ x * CELL + i, y * CELL + j }] = pc;
-							else if (i == j+1 || (i == 0 && j == CELL-1))
-								video[{ x * CELL + i, y * CELL + j }] = gc;
-							else
-								video[{ x * CELL + i, y * CELL + j }] = 0x202020_rgb .Pack();
-					break;
+					BlendText({ x*CELL, y*CELL-2 }, 0xE00D, 0xFFFFFF_rgb .WithAlpha(128));
 				}
 
 				// when in blob view, draw some blobs...
 				if (render_mode & PMODE_BLOB)
 				{
+					RGB<uint8_t> prgb = wtypes[wt].colour;
+					RGB<uint8_t> grgb = wtypes[wt].eglow;
+
+					if (findingElement)
+					{
+						prgb.Red   /= 10;
+						prgb.Green /= 10;
+						prgb.Blue  /= 10;
+						grgb.Red   /= 10;
+						grgb.Green /= 10;
+						grgb.Blue  /= 10;
+					}
+
+					pixel gc = grgb.Pack();
+
 					switch (wtypes[wt].drawstyle)
 					{
 					case 0:
@@ -1236,9 +1299,5 @@ int HeatToColour(float temp)
 {
 	constexpr float min_temp = MIN_TEMP;
 	constexpr float max_temp = MAX_TEMP;
-	RGB<uint8_t> color = Renderer::heatTableAt(int((temp - min_temp) / (max_temp - min_temp) * 1024));
-	color.Red   = uint8_t(color.Red   * 0.7f);
-	color.Green = uint8_t(color.Green * 0.7f);
-	color.Blue  = uint8_t(color.Blue  * 0.7f);
-	return color.Pack();
+	return Renderer::airHeatTableAt(int((temp - min_temp) / (max_temp - min_temp) * 1024)).Pack();
 }
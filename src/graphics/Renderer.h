@@ -156,6 +156,7 @@ public:
 	RENDERER_TABLE(flameTable)
 	RENDERER_TABLE(plasmaTable)
 	RENDERER_TABLE(heatTable)
+	RENDERER_TABLE(airHeatTable) // heatTable dimmed to 70%, see HeatToColour
 	RENDERER_TABLE(clfmTable)
 	RENDERER_TABLE(firwTable)
 #undef RENDERER_TABLE
@@ -163,4 +164,19 @@ public:
 
 private:
 	int gridSize;
+
+	struct WallPattern
+	{
+		// The pixels a wall covers in its cell, as offsets into video from the top left
+		// corner of the cell; if it covers all of them, they are in row-major order.
+		std::array<int, CELL * CELL> offset;
+		std::array<pixel, CELL * CELL> colour;
+		int count;
+		bool opaque;
+	};
+	// What DrawWalls draws into each cell, per wall type and powered state. The patterns
+	// only change with the colours they are drawn in, which depend on element finding.
+	std::vector<std::array<WallPattern, 2>> wallPatterns;
+	int wallPatternsDimmed = -1;
+	void BuildWallPatterns(bool dimmed);
 };
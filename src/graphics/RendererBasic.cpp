@@ -1,6 +1,7 @@
 #include <cmath>
 #include "gui/game/RenderPreset.h"
 #include "RasterDrawMethodsImpl.h"
+#include "common/ForEachBand.h"
 #include "Renderer.h"
 #include "simulation/ElementClasses.h"
 #include "simulation/ElementGraphics.h"
@@ -111,28 +112,55 @@ void Renderer::DrawBlob(Vec2<int> pos, RGB<uint8_t> colour)
 
 void Renderer::render_gravlensing(const Video &source)
 {
-	int nx, ny, rx, ry, gx, gy, bx, by, co;
-	for(nx = 0; nx < XRES; nx++)
-	{
-		for(ny = 0; ny < YRES; ny++)
+	auto addChannels = [](RGB<uint8_t> t, int r, int g, int b) {
+		t.Red   = std::min(0xFF, r + t.Red);
+		t.Green = std::min(0xFF, g + t.Green);
+		t.Blue  = std::min(0xFF, b + t.Blue);
+		return t.Pack();
+	};
+	// rows only write to themselves, so bands of them can be lensed in parallel
+	ForEachBand(YRES, CELL * 16, [this, &source, addChannels](int, int begin, int end) {
+		for (int ny = begin; ny < end; ny++)
 		{
-			co = (ny/CELL)*XCELLS+(nx/CELL);
-			rx = (int)(nx-sim->gravx[co]*0.75f+0.5f);
-			ry = (int)(ny-sim->gravy[co]*0.75f+0.5f);
-			gx = (int)(nx-sim->gravx[co]*0.875f+0.5f);
-			gy = (int)(ny-sim->gravy[co]*0.875f+0.5f);
-			bx = (int)(nx-sim->gravx[co]+0.5f);
-			by = (int)(ny-sim->gravy[co]+0.5f);
-			if(rx >= 0 && rx < XRES && ry >= 0 && ry < YRES && gx >= 0 && gx < XRES && gy >= 0 && gy < YRES && bx >= 0 && bx < XRES && by >= 0 && by < YRES)
+			auto *dst = &*video.RowIterator({ 0, ny });
+			auto *src = &*source.RowIterator({ 0, ny });
+			auto *rowGravX = &sim->gravx[(ny / CELL) * XCELLS];
+			auto *rowGravY = &sim->gravy[(ny / CELL) * XCELLS];
+			for (int cx = 0; cx < XCELLS; cx++)
 			{
-				auto t = RGB<uint8_t>::Unpack(video[{ nx, ny }]);
-				t.Red   = std::min(0xFF, (int)RGB<uint8_t>::Unpack(source[{ rx, ry }]).Red   + t.Red);
-				t.Green = std::min(0xFF, (int)RGB<uint8_t>::Unpack(source[{ gx, gy }]).Green + t.Green);
-				t.Blue  = std::min(0xFF, (int)RGB<uint8_t>::Unpack(source[{ bx, by }]).Blue  + t.Blue);
-				video[{ nx, ny }] = t.Pack();
+				auto gravX = rowGravX[cx];
+				auto gravY = rowGravY[cx];
+				if (gravX == 0.0f && gravY == 0.0f)
+				{
+					// no displacement, all three channels sample the pixel right below
+					for (int nx = cx * CELL; nx < (cx + 1) * CELL; nx++)
+					{
+						auto s = RGB<uint8_t>::Unpack(src[nx]);
+						dst[nx] = addChannels(RGB<uint8_t>::Unpack(dst[nx]), s.Red, s.Green, s.Blue);
+					}
+					continue;
+				}
+				int ry = (int)(ny - gravY * 0.75f  + 0.5f);
+				int gy = (int)(ny - gravY * 0.875f + 0.5f);
+				int by = (int)(ny - gravY          + 0.5f);
+				if (ry < 0 || ry >= YRES || gy < 0 || gy >= YRES || by < 0 || by >= YRES)
+					continue;
+				for (int nx = cx * CELL; nx < (cx + 1) * CELL; nx++)
+				{
+					int rx = (int)(nx - gravX * 0.75f  + 0.5f);
+					int gx = (int)(nx - gravX * 0.875f + 0.5f);
+					int bx = (int)(nx - gravX          + 0.5f);
+					if (rx >= 0 && rx < XRES && gx >= 0 && gx < XRES && bx >= 0 && bx < XRES)
+					{
+						dst[nx] = addChannels(RGB<uint8_t>::Unpack(dst[nx]),
+							RGB<uint8_t>::Unpack(source[{ rx, ry }]).Red,
+							RGB<uint8_t>::Unpack(source[{ gx, gy }]).Green,
+							RGB<uint8_t>::Unpack(source[{ bx, by }]).Blue);
+					}
+				}
 			}
 		}
-	}
+	});
 }
 
 float temp[CELL*3][CELL*3];
@@ -168,6 +196,7 @@ pixel Renderer::GetPixel(Vec2<int> pos) const
 std::vector<RGB<uint8_t>> Renderer::flameTable;
 std::vector<RGB<uint8_t>> Renderer::plasmaTable;
 std::vector<RGB<uint8_t>> Renderer::heatTable;
+std::vector<RGB<uint8_t>> Renderer::airHeatTable;
 std::vector<RGB<uint8_t>> Renderer::clfmTable;
 std::vector<RGB<uint8_t>> Renderer::firwTable;
 static bool tablesPopulated = false;
@@ -203,6 +232,10 @@ void Renderer::PopulateTables()
 			{ 0xFF0000_rgb, 0.71f },
 			{ 0xFF00DC_rgb, 1.00f },
 		}, 1024);
+		for (auto colour : heatTable)
+		{
+			airHeatTable.push_back(RGB<uint8_t>(uint8_t(colour.Red * 0.7f), uint8_t(colour.Green * 0.7f), uint8_t(colour.Blue * 0.7f)));
+		}
 		clfmTable = Graphics::Gradient({
 			{ 0x000000_rgb, 0.00f },
 			{ 0x0A0917_rgb, 0.10f },
@@ -1145,6 +1145,11 @@ Tool *GameController::GetLastTool()
 	return gameModel->GetLastTool();
 }
 
+std::vector<EventHandlerProfile> GameController::GetEventHandlerProfile()
+{
+	return commandInterface->GetEventHandlerProfile();
+}
+
 int GameController::GetReplaceModeFlags()
 {
 	return gameModel->GetSimulation()->replaceModeFlags;
@@ -37,6 +37,7 @@ class GameSave;
 class LoginController;
 class TagsController;
 class ConsoleController;
+struct EventHandlerProfile;
 class GameController: public ClientListener
 {
 	CommandInterfacePtr commandInterface;
@@ -140,6 +141,7 @@ public:
 	Tool *GetLastTool();
 	int GetReplaceModeFlags();
 	void SetReplaceModeFlags(int flags);
+	std::vector<EventHandlerProfile> GetEventHandlerProfile();
 	void SetActiveColourPreset(int preset);
 	void SetColour(ui::Colour colour);
 	void SetToolStrength(float value);
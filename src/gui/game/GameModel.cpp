@@ -23,6 +23,7 @@
 #include "graphics/Renderer.h"
 #include "simulation/Air.h"
 #include "simulation/GOLString.h"
+#include "simulation/Replay.h"
 #include "simulation/gravity/Gravity.h"
 #include "simulation/Simulation.h"
 #include "simulation/Snapshot.h"
@@ -962,6 +963,7 @@ void GameModel::SaveToSimParameters(const GameSave &saveData)
 	sim->customGravityX = saveData.customGravityX;
 	sim->customGravityY = saveData.customGravityY;
 	sim->air->airMode = saveData.airMode;
+	sim->heatMode = (saveData.heatMode >= 0 && saveData.heatMode < NUM_HEATMODES) ? saveData.heatMode : HEAT_STOCHASTIC;
 	sim->air->ambientAirTemp = saveData.ambientAirTemp;
 	sim->edgeMode = saveData.edgeMode;
 	sim->legacy_enable = saveData.legacyEnable;
@@ -1340,6 +1342,7 @@ void GameModel::ClearSimulation()
 	sim->customGravityX = 0.0f;
 	sim->customGravityY = 0.0f;
 	sim->air->airMode = AIR_ON;
+	sim->heatMode = HEAT_STOCHASTIC;
 	sim->legacy_enable = false;
 	sim->water_equal_test = false;
 	sim->SetEdgeMode(edgeMode);
@@ -1694,9 +1697,10 @@ void GameModel::UpdateUpTo(int upTo)
 	}
 	if (sim->debug_nextToUpdate == 0)
 	{
-		BeforeSim();
+		BeforeSim(true);
 	}
 	sim->UpdateParticles(sim->debug_nextToUpdate, upTo);
+	CommandInterface::Ref().FlushBatchUpdates();
 	if (upTo < NPART)
 	{
 		sim->debug_nextToUpdate = upTo;
@@ -1708,17 +1712,42 @@ void GameModel::UpdateUpTo(int upTo)
 	}
 }
 
-void GameModel::BeforeSim()
+void GameModel::BeforeSim(bool stepping)
 {
 	if (!sim->sys_pause || sim->framerender)
 	{
 		CommandInterface::Ref().HandleEvent(BeforeSimEvent{});
 	}
+	if (replay && stepping)
+	{
+		replay->BeforeFrame(*sim);
+	}
 	sim->BeforeSim();
 }
 
 void GameModel::AfterSim()
 {
 	sim->AfterSim();
+	if (replay)
+	{
+		// before the event, so that whatever scripts do in response is recorded as an edit
+		replay->AfterFrame(*sim);
+	}
 	CommandInterface::Ref().HandleEvent(AfterSimEvent{});
 }
+
+void GameModel::StartReplay(uint64_t keyframeInterval)
+{
+	replay = std::make_unique<Replay>();
+	replay->keyframeInterval = keyframeInterval;
+}
+
+std::unique_ptr<Replay> GameModel::StopReplay()
+{
+	return std::move(replay);
+}
+
+bool GameModel::IsRecordingReplay() const
+{
+	return bool(replay);
+}
@@ -23,6 +23,7 @@ class Simulation;
 class Renderer;
 class Snapshot;
 struct SnapshotDelta;
+class Replay;
 class GameSave;
 
 namespace http
@@ -83,6 +84,7 @@ private:
 	std::unique_ptr<Snapshot> historyCurrent;
 	unsigned int historyPosition;
 	unsigned int undoHistoryLimit;
+	std::unique_ptr<Replay> replay;
 	bool mouseClickRequired;
 	bool includePressure;
 	bool perfectCircle = true;
@@ -179,6 +181,10 @@ public:
 	unsigned int GetUndoHistoryLimit();
 	void SetUndoHistoryLimit(unsigned int undoHistoryLimit_);
 
+	void StartReplay(uint64_t keyframeInterval);
+	std::unique_ptr<Replay> StopReplay();
+	bool IsRecordingReplay() const;
+
 	void UpdateQuickOptions();
 
 	Tool * GetActiveTool(int selection);
@@ -271,6 +277,6 @@ public:
 	int SelectNextTool;
 
 	void UpdateUpTo(int upTo);
-	void BeforeSim();
+	void BeforeSim(bool stepping = false);
 	void AfterSim();
 };
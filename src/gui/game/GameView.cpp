@@ -33,6 +33,7 @@
 #include "gui/interface/Button.h"
 #include "gui/interface/Colour.h"
 #include "gui/interface/Engine.h"
+#include "lua/CommandInterface.h"
 
 #include "Config.h"
 #include <cstring>
@@ -2498,6 +2499,24 @@ void GameView::OnDraw()
 		int alpha = 255-introText*5;
 		g->BlendFilledRect(RectSized(Vec2{ 12, 12 }, Vec2{ textWidth+8, 15 }), 0x000000_rgb .WithAlpha(int(alpha*0.5)));
 		g->BlendText({ 16, 16 }, fpsInfo.Build(), 0x20D8FF_rgb .WithAlpha(int(alpha*0.75)));
+
+		if (showDebug)
+		{
+			// event handlers that took the most time last frame
+			auto profile = c->GetEventHandlerProfile();
+			constexpr auto maxHandlers = 8;
+			int y = 30;
+			for (auto i = 0; i < int(profile.size()) && i < maxHandlers; ++i)
+			{
+				StringBuilder handlerInfo;
+				handlerInfo << Format::Precision(2) << profile[i].lastFrameTime * 1000.0 << "ms " << profile[i].name.FromUtf8();
+				handlerInfo << " (" << Format::Precision(0) << profile[i].totalTime * 1000.0 << "ms total, " << profile[i].calls << " calls)";
+				int handlerWidth = Graphics::TextSize(handlerInfo.Build()).X - 1;
+				g->BlendFilledRect(RectSized(Vec2{ 12, y }, Vec2{ handlerWidth+8, 14 }), 0x000000_rgb .WithAlpha(int(alpha*0.5)));
+				g->BlendText({ 16, y + 3 }, handlerInfo.Build(), 0xFFFFFF_rgb .WithAlpha(int(alpha*0.75)));
+				y += 14;
+			}
+		}
 	}
 
 	//Tooltips
@@ -22,8 +22,13 @@ void AvatarButton::Tick(float dt)
 	if (!avatar && !tried && name.size() > 0)
 	{
 		tried = true;
-		imageRequest = std::make_unique<http::ImageRequest>(ByteString::Build(SCHEME, STATICSERVER, "/avatars/", name, ".png"), Size);
-		imageRequest->Start();
+		auto url = ByteString::Build(SCHEME, STATICSERVER, "/avatars/", name, ".png");
+		avatar = http::ImageRequest::Cached(url, Size);
+		if (!avatar)
+		{
+			imageRequest = std::make_unique<http::ImageRequest>(url, Size);
+			imageRequest->Start();
+		}
 	}
 
 	if (imageRequest && imageRequest->CheckDone())
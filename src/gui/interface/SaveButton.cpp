@@ -133,8 +133,12 @@ void SaveButton::Tick(float dt)
 				}
 				else if (save->GetID())
 				{
-					thumbnailRequest = std::make_unique<http::ThumbnailRequest>(save->GetID(), save->GetVersion(), thumbBoxSize);
-					thumbnailRequest->Start();
+					thumbnail = http::ImageRequest::Cached(http::ThumbnailRequest::Url(save->GetID(), save->GetVersion()), thumbBoxSize);
+					if (!thumbnail)
+					{
+						thumbnailRequest = std::make_unique<http::ThumbnailRequest>(save->GetID(), save->GetVersion(), thumbBoxSize);
+						thumbnailRequest->Start();
+					}
 					triedThumbnail = true;
 				}
 			}
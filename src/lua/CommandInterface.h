@@ -4,12 +4,24 @@
 #include "common/String.h"
 #include "gui/game/GameControllerEvents.h"
 #include "TPTSTypes.h"
+#include <cstdint>
 #include <deque>
+#include <vector>
 
 class GameModel;
 class GameController;
 class Tool;
 
+struct EventHandlerProfile
+{
+	ByteString name;
+	const void *function = nullptr; // identity only, never dereferenced
+	uint64_t calls = 0;
+	double frameTime = 0; // seconds, current frame
+	double lastFrameTime = 0; // seconds, previous frame
+	double totalTime = 0; // seconds
+};
+
 class CommandInterface : public ExplicitSingleton<CommandInterface>
 {
 protected:
@@ -32,8 +44,10 @@ public:
 
 	void OnTick();
 	void Init();
+	void FlushBatchUpdates();
 
 	bool HandleEvent(const GameControllerEvent &event);
+	std::vector<EventHandlerProfile> GetEventHandlerProfile();
 
 	int Command(String command);
 	String FormatCommand(String command);
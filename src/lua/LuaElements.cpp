@@ -96,6 +96,68 @@ static void manageElementIdentifier(lua_State *L, int id, bool add)
 	}
 }
 
+static void flushBatchUpdate(lua_State *L, int t)
+{
+	auto *lsi = GetLSI();
+	auto *sim = lsi->sim;
+	auto &customElement = lsi->customElements[t];
+	// take the queue so that anything the callback does to the simulation starts a new one
+	auto pending = std::move(customElement.batchUpdatePending);
+	customElement.batchUpdatePending.clear();
+	if (!customElement.batchUpdate)
+	{
+		return;
+	}
+	customElement.batchUpdateIds.Push(L);
+	int count = 0;
+	for (auto id : pending)
+	{
+		// skip particles that have been killed or have changed type since they were queued
+		if (sim->parts[id].type != t)
+		{
+			continue;
+		}
+		pending[count] = id;
+		count += 1;
+		lua_pushinteger(L, id);
+		lua_rawseti(L, -2, count);
+	}
+	for (int j = count + 1; j <= customElement.batchUpdateIdsLen; j++)
+	{
+		lua_pushnil(L);
+		lua_rawseti(L, -2, j);
+	}
+	customElement.batchUpdateIdsLen = count;
+	if (!count)
+	{
+		lua_pop(L, 1);
+		return;
+	}
+	customElement.batchUpdate.Push(L);
+	lua_insert(L, -2);
+	lua_pushinteger(L, count);
+	// the same IDs as a contiguous int32 array, e.g. for ffi.cast("int *", ...); valid only during the call
+	lua_pushlightuserdata(L, pending.data());
+	if (tpt_lua_pcall(L, 3, 0, 0, eventTraitSimRng))
+	{
+		lsi->Log(CommandInterface::LogError, "In batch update: " + LuaGetError());
+		lua_pop(L, 1);
+	}
+}
+
+void LuaElements::FlushBatchUpdates(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	auto &customElements = lsi->customElements;
+	for (int t = 0; t < int(customElements.size()); t++)
+	{
+		if (!customElements[t].batchUpdatePending.empty())
+		{
+			flushBatchUpdate(L, t);
+		}
+	}
+}
+
 static int luaUpdateWrapper(UPDATE_FUNC_ARGS)
 {
 	if (!sim->useLuaCallbacks)
@@ -106,6 +168,22 @@ static int luaUpdateWrapper(UPDATE_FUNC_ARGS)
 	auto &builtinElements = GetElements();
 	auto *builtinUpdate = builtinElements[parts[i].type].Update;
 	auto &customElements = lsi->customElements;
+	if (customElements[parts[i].type].batchUpdate)
+	{
+		auto t = parts[i].type;
+		auto &customElement = customElements[t];
+		// particles are queued in the order the per-particle path visits them; a full chunk is
+		// dispatched before this particle's own update, so earlier particles are still handled first
+		if (int(customElement.batchUpdatePending.size()) >= customElement.batchUpdateChunk)
+		{
+			flushBatchUpdate(lsi->L, t);
+			if (parts[i].type != t)
+				return 1;
+			x = (int)(parts[i].x+0.5f);
+			y = (int)(parts[i].y+0.5f);
+		}
+		customElement.batchUpdatePending.push_back(i);
+	}
 	if (builtinUpdate && customElements[parts[i].type].updateMode == UPDATE_AFTER)
 	{
 		if (builtinUpdate(UPDATE_FUNC_SUBCALL_ARGS))
@@ -321,6 +399,30 @@ static bool luaCtypeDrawWrapper(CTYPEDRAW_FUNC_ARGS)
 	return ret;
 }
 
+static void setBatchUpdate(lua_State *L, int id, int stackPos, int chunk)
+{
+	// particles already queued are handed to the new callback
+	auto &customElement = GetLSI()->customElements[id];
+	customElement.batchUpdate.Assign(L, stackPos);
+	customElement.batchUpdateChunk = chunk;
+	if (!customElement.batchUpdateIds)
+	{
+		lua_createtable(L, std::min(chunk, defaultBatchUpdateChunk), 0);
+		customElement.batchUpdateIds.Assign(L, -1);
+		lua_pop(L, 1);
+		customElement.batchUpdateIdsLen = 0;
+	}
+}
+
+static void clearBatchUpdate(int id)
+{
+	auto &customElement = GetLSI()->customElements[id];
+	customElement.batchUpdatePending.clear();
+	customElement.batchUpdate.Clear();
+	customElement.batchUpdateIds.Clear();
+	customElement.batchUpdateIdsLen = 0;
+}
+
 static int allocate(lua_State *L)
 {
 	auto *lsi = GetLSI();
@@ -449,7 +551,26 @@ static int element(lua_State *L)
 			{
 				customElements[id].update.Clear();
 				customElements[id].updateMode = UPDATE_AFTER;
-				elements[id].Update = builtinElements[id].Update;
+				if (!customElements[id].batchUpdate)
+				{
+					elements[id].Update = builtinElements[id].Update;
+				}
+			}
+			lua_pop(L, 1);
+
+			lua_getfield(L, -1, "BatchUpdate");
+			if (lua_type(L, -1) == LUA_TFUNCTION)
+			{
+				setBatchUpdate(L, id, -1, defaultBatchUpdateChunk);
+				elements[id].Update = luaUpdateWrapper;
+			}
+			else if (lua_type(L, -1) == LUA_TBOOLEAN && !lua_toboolean(L, -1))
+			{
+				clearBatchUpdate(id);
+				if (!customElements[id].update)
+				{
+					elements[id].Update = builtinElements[id].Update;
+				}
 			}
 			lua_pop(L, 1);
 
@@ -621,7 +742,31 @@ static int property(lua_State *L)
 			{
 				customElements[id].update.Clear();
 				customElements[id].updateMode = UPDATE_AFTER;
-				elements[id].Update = builtinElements[id].Update;
+				if (!customElements[id].batchUpdate)
+				{
+					elements[id].Update = builtinElements[id].Update;
+				}
+			}
+		}
+		else if (propertyName == "BatchUpdate")
+		{
+			if (lua_type(L, 3) == LUA_TFUNCTION)
+			{
+				int chunk = luaL_optint(L, 4, defaultBatchUpdateChunk);
+				if (chunk < 1)
+				{
+					return luaL_error(L, "Invalid chunk size");
+				}
+				setBatchUpdate(L, id, 3, chunk);
+				elements[id].Update = luaUpdateWrapper;
+			}
+			else if (lua_type(L, 3) == LUA_TBOOLEAN && !lua_toboolean(L, 3))
+			{
+				clearBatchUpdate(id);
+				if (!customElements[id].update)
+				{
+					elements[id].Update = builtinElements[id].Update;
+				}
 			}
 		}
 		else if (propertyName == "Graphics")
@@ -752,6 +897,7 @@ static int ffree(lua_State *L)
 	}
 	auto *lsi = GetLSI();
 	lsi->gameModel->BuildMenus();
+	lsi->InitCustomCanMove();
 
 	lua_getglobal(L, "elements");
 	tpt_lua_pushByteString(L, identifier);
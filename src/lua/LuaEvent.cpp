@@ -1,6 +1,29 @@
 #include "LuaScriptInterface.h"
 #include "common/VariantIndex.h"
 #include "PowderToySDL.h"
+#include <array>
+
+static const std::array<const char *, std::variant_size_v<GameControllerEvent>> eventNames = []() {
+	std::array<const char *, std::variant_size_v<GameControllerEvent>> names{};
+#define LVINAME(id, v) names[VariantIndex<GameControllerEvent, id>()] = v
+	LVINAME(TextInputEvent    , "TEXTINPUT"    );
+	LVINAME(TextEditingEvent  , "TEXTEDITING"  );
+	LVINAME(KeyPressEvent     , "KEYPRESS"     );
+	LVINAME(KeyReleaseEvent   , "KEYRELEASE"   );
+	LVINAME(MouseDownEvent    , "MOUSEDOWN"    );
+	LVINAME(MouseUpEvent      , "MOUSEUP"      );
+	LVINAME(MouseMoveEvent    , "MOUSEMOVE"    );
+	LVINAME(MouseWheelEvent   , "MOUSEWHEEL"   );
+	LVINAME(TickEvent         , "TICK"         );
+	LVINAME(BlurEvent         , "BLUR"         );
+	LVINAME(CloseEvent        , "CLOSE"        );
+	LVINAME(BeforeSimEvent    , "BEFORESIM"    );
+	LVINAME(AfterSimEvent     , "AFTERSIM"     );
+	LVINAME(BeforeSimDrawEvent, "BEFORESIMDRAW");
+	LVINAME(AfterSimDrawEvent , "AFTERSIMDRAW" );
+#undef LVINAME
+	return names;
+}();
 
 static int fregister(lua_State *L)
 {
@@ -15,6 +38,15 @@ static int fregister(lua_State *L)
 	auto length = lua_objlen(L, -1);
 	lua_pushvalue(L, 2);
 	lua_rawseti(L, -2, length + 1);
+	{
+		EventHandlerProfile profile;
+		profile.function = lua_topointer(L, 2);
+		lua_Debug ar;
+		lua_pushvalue(L, 2);
+		lua_getinfo(L, ">S", &ar);
+		profile.name = ByteString::Build(eventNames[eventType], " ", ar.short_src, ":", ar.linedefined);
+		lsi->gameControllerEventHandlerProfiles[eventType].push_back(profile);
+	}
 	lua_pushvalue(L, 2);
 	return 1;
 }
@@ -37,6 +69,11 @@ static int unregister(lua_State *L)
 		if (!skip && lua_equal(L, -1, 2))
 		{
 			skip = 1;
+			auto &profiles = lsi->gameControllerEventHandlerProfiles[eventType];
+			if (i - 1 < profiles.size())
+			{
+				profiles.erase(profiles.begin() + (i - 1));
+			}
 		}
 		lua_pop(L, 1);
 		lua_rawgeti(L, -1, i + skip);
@@ -63,23 +100,11 @@ void LuaEvent::Open(lua_State *L)
 	};
 	lua_newtable(L);
 	luaL_register(L, NULL, reg);
-#define LVICONST(id, v) lua_pushinteger(L, VariantIndex<GameControllerEvent, id>()); lua_setfield(L, -2, v)
-	LVICONST(TextInputEvent    , "TEXTINPUT"    );
-	LVICONST(TextEditingEvent  , "TEXTEDITING"  );
-	LVICONST(KeyPressEvent     , "KEYPRESS"     );
-	LVICONST(KeyReleaseEvent   , "KEYRELEASE"   );
-	LVICONST(MouseDownEvent    , "MOUSEDOWN"    );
-	LVICONST(MouseUpEvent      , "MOUSEUP"      );
-	LVICONST(MouseMoveEvent    , "MOUSEMOVE"    );
-	LVICONST(MouseWheelEvent   , "MOUSEWHEEL"   );
-	LVICONST(TickEvent         , "TICK"         );
-	LVICONST(BlurEvent         , "BLUR"         );
-	LVICONST(CloseEvent        , "CLOSE"        );
-	LVICONST(BeforeSimEvent    , "BEFORESIM"    );
-	LVICONST(AfterSimEvent     , "AFTERSIM"     );
-	LVICONST(BeforeSimDrawEvent, "BEFORESIMDRAW");
-	LVICONST(AfterSimDrawEvent , "AFTERSIMDRAW" );
-#undef LVICONST
+	for (auto i = 0U; i < eventNames.size(); ++i)
+	{
+		lua_pushinteger(L, i);
+		lua_setfield(L, -2, eventNames[i]);
+	}
 	lua_pushvalue(L, -1);
 	lua_setglobal(L, "event");
 	lua_setglobal(L, "evt");
@@ -227,6 +227,237 @@ static int fillCircle(lua_State *L)
 	return 0;
 }
 
+static RGBA<uint8_t> optColour(lua_State *L, int index)
+{
+	return RGBA<uint8_t>(
+		std::clamp(luaL_optint(L, index    , 255), 0, 255),
+		std::clamp(luaL_optint(L, index + 1, 255), 0, 255),
+		std::clamp(luaL_optint(L, index + 2, 255), 0, 255),
+		std::clamp(luaL_optint(L, index + 3, 255), 0, 255)
+	);
+}
+
+// Image data is passed as a string of w*h pixels, 4 bytes each in R, G, B, A order.
+static std::vector<pixel_rgba> checkImage(lua_State *L, int index, Vec2<int> size)
+{
+	if (size.X < 0 || size.Y < 0 || size.X > 0x1000 || size.Y > 0x1000)
+	{
+		luaL_error(L, "Invalid image size %dx%d", size.X, size.Y);
+	}
+	size_t length;
+	auto *data = reinterpret_cast<const uint8_t *>(luaL_checklstring(L, index, &length));
+	if (length != size_t(size.X * size.Y * 4))
+	{
+		luaL_error(L, "Image data is %d bytes long, %d expected", int(length), size.X * size.Y * 4);
+	}
+	std::vector<pixel_rgba> image(size.X * size.Y);
+	for (auto &px : image)
+	{
+		px = RGBA<uint8_t>(data[0], data[1], data[2], data[3]).Pack();
+		data += 4;
+	}
+	return image;
+}
+
+static int drawImage(lua_State *L)
+{
+	int x = lua_tointeger(L, 1);
+	int y = lua_tointeger(L, 2);
+	int w = lua_tointeger(L, 3);
+	int h = lua_tointeger(L, 4);
+	auto image = checkImage(L, 5, { w, h });
+	std::visit([x, y, w, h, &image](auto p) {
+		p->BlendRGBAImage(image.data(), RectSized(Vec2{ x, y }, Vec2{ w, h }));
+	}, currentGraphics());
+	return 0;
+}
+
+// A draw list records drawing commands once and replays them with one call per frame, which saves
+// scripts that draw a lot of mostly static things the cost of crossing into C for every shape.
+struct DrawList
+{
+	enum Kind
+	{
+		commandPixel,
+		commandLine,
+		commandRect,
+		commandFillRect,
+		commandCircle,
+		commandFillCircle,
+		commandText,
+		commandImage,
+	};
+
+	struct Command
+	{
+		Kind kind;
+		Vec2<int> pos, other; // other is the second point, the size or the radius, depending on kind
+		RGBA<uint8_t> colour;
+		size_t data; // index into texts or images
+	};
+
+	std::vector<Command> commands;
+	std::vector<String> texts;
+	std::vector<std::vector<pixel_rgba>> images;
+
+	template<class Target>
+	void Draw(Target *p) const
+	{
+		for (auto &command : commands)
+		{
+			auto opaque = command.colour.Alpha == 255;
+			switch (command.kind)
+			{
+			case commandPixel:
+				p->BlendPixel(command.pos, command.colour);
+				break;
+
+			case commandLine:
+				if (opaque)
+					p->DrawLine(command.pos, command.other, command.colour.NoAlpha());
+				else
+					p->BlendLine(command.pos, command.other, command.colour);
+				break;
+
+			case commandRect:
+				if (opaque)
+					p->DrawRect(RectSized(command.pos, command.other), command.colour.NoAlpha());
+				else
+					p->BlendRect(RectSized(command.pos, command.other), command.colour);
+				break;
+
+			case commandFillRect:
+				if (opaque)
+					p->DrawFilledRect(RectSized(command.pos, command.other), command.colour.NoAlpha());
+				else
+					p->BlendFilledRect(RectSized(command.pos, command.other), command.colour);
+				break;
+
+			case commandCircle:
+				p->BlendEllipse(command.pos, command.other, command.colour);
+				break;
+
+			case commandFillCircle:
+				p->BlendFilledEllipse(command.pos, command.other, command.colour);
+				break;
+
+			case commandText:
+				p->BlendText(command.pos, texts[command.data], command.colour);
+				break;
+
+			case commandImage:
+				p->BlendRGBAImage(images[command.data].data(), RectSized(command.pos, command.other));
+				break;
+			}
+		}
+	}
+};
+
+static DrawList *checkDrawList(lua_State *L)
+{
+	return (DrawList *)luaL_checkudata(L, 1, "DrawList");
+}
+
+static int DrawList_gc(lua_State *L)
+{
+	checkDrawList(L)->~DrawList();
+	return 0;
+}
+
+static int DrawList_shape(lua_State *L, DrawList::Kind kind)
+{
+	auto *list = checkDrawList(L);
+	auto other = Vec2<int>{ int(lua_tointeger(L, 4)), int(lua_tointeger(L, 5)) };
+	if (kind == DrawList::commandCircle || kind == DrawList::commandFillCircle)
+	{
+		other = { std::abs(other.X), std::abs(other.Y) };
+	}
+	list->commands.push_back({ kind, { int(lua_tointeger(L, 2)), int(lua_tointeger(L, 3)) }, other, optColour(L, 6), 0 });
+	return 0;
+}
+
+static int DrawList_pixel(lua_State *L)
+{
+	auto *list = checkDrawList(L);
+	list->commands.push_back({ DrawList::commandPixel, { luaL_optint(L, 2, 0), luaL_optint(L, 3, 0) }, { 0, 0 }, optColour(L, 4), 0 });
+	return 0;
+}
+
+static int DrawList_line(lua_State *L)
+{
+	return DrawList_shape(L, DrawList::commandLine);
+}
+
+static int DrawList_rect(lua_State *L)
+{
+	return DrawList_shape(L, DrawList::commandRect);
+}
+
+static int DrawList_fillRect(lua_State *L)
+{
+	return DrawList_shape(L, DrawList::commandFillRect);
+}
+
+static int DrawList_circle(lua_State *L)
+{
+	return DrawList_shape(L, DrawList::commandCircle);
+}
+
+static int DrawList_fillCircle(lua_State *L)
+{
+	return DrawList_shape(L, DrawList::commandFillCircle);
+}
+
+static int DrawList_text(lua_State *L)
+{
+	auto *list = checkDrawList(L);
+	list->texts.push_back(tpt_lua_optString(L, 4, ""));
+	list->commands.push_back({ DrawList::commandText, { int(lua_tointeger(L, 2)), int(lua_tointeger(L, 3)) }, { 0, 0 }, optColour(L, 5), list->texts.size() - 1 });
+	return 0;
+}
+
+static int DrawList_image(lua_State *L)
+{
+	auto *list = checkDrawList(L);
+	auto size = Vec2<int>{ int(lua_tointeger(L, 4)), int(lua_tointeger(L, 5)) };
+	list->images.push_back(checkImage(L, 6, size));
+	list->commands.push_back({ DrawList::commandImage, { int(lua_tointeger(L, 2)), int(lua_tointeger(L, 3)) }, size, 0x000000_rgb .WithAlpha(255), list->images.size() - 1 });
+	return 0;
+}
+
+static int DrawList_clear(lua_State *L)
+{
+	auto *list = checkDrawList(L);
+	list->commands.clear();
+	list->texts.clear();
+	list->images.clear();
+	return 0;
+}
+
+static int DrawList_size(lua_State *L)
+{
+	lua_pushinteger(L, int(checkDrawList(L)->commands.size()));
+	return 1;
+}
+
+static int DrawList_draw(lua_State *L)
+{
+	auto *list = checkDrawList(L);
+	std::visit([list](auto p) {
+		list->Draw(p);
+	}, currentGraphics());
+	return 0;
+}
+
+static int newDrawList(lua_State *L)
+{
+	auto *list = (DrawList *)lua_newuserdata(L, sizeof(DrawList));
+	new(list) DrawList();
+	luaL_newmetatable(L, "DrawList");
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
 static int getColors(lua_State *L)
 {
 	unsigned int color = int32Truncate(lua_tonumber(L, 1));
@@ -292,9 +523,36 @@ void LuaGraphics::Open(lua_State *L)
 		LFUNC(getColors),
 		LFUNC(getHexColor),
 		LFUNC(setClipRect),
+		LFUNC(drawImage),
+		LFUNC(newDrawList),
 #undef LFUNC
 		{ NULL, NULL }
 	};
+	{
+		static const luaL_Reg reg[] = {
+#define LFUNC(v) { #v, DrawList_ ## v }
+			LFUNC(pixel),
+			LFUNC(line),
+			LFUNC(rect),
+			LFUNC(fillRect),
+			LFUNC(circle),
+			LFUNC(fillCircle),
+			LFUNC(text),
+			LFUNC(image),
+			LFUNC(clear),
+			LFUNC(size),
+			LFUNC(draw),
+#undef LFUNC
+			{ NULL, NULL }
+		};
+		luaL_newmetatable(L, "DrawList");
+		lua_pushcfunction(L, DrawList_gc);
+		lua_setfield(L, -2, "__gc");
+		lua_newtable(L);
+		luaL_register(L, NULL, reg);
+		lua_setfield(L, -2, "__index");
+		lua_pop(L, 1);
+	}
 	lua_newtable(L);
 	luaL_register(L, NULL, reg);
 #define LCONSTAS(k, v) lua_pushinteger(L, int(v)); lua_setfield(L, -2, k)
@@ -13,6 +13,8 @@
 #include "prefs/GlobalPrefs.h"
 #include "simulation/Simulation.h"
 #include "simulation/SimulationData.h"
+#include <algorithm>
+#include <chrono>
 
 static int atPanic(lua_State *L)
 {
@@ -123,7 +125,8 @@ LuaScriptInterface::LuaScriptInterface(GameController *newGameController, GameMo
 	g(ui::Engine::Ref().g),
 	ren(gameModel->GetRenderer()),
 	customElements(PT_NUM),
-	gameControllerEventHandlers(std::variant_size_v<GameControllerEvent>)
+	gameControllerEventHandlers(std::variant_size_v<GameControllerEvent>),
+	gameControllerEventHandlerProfiles(std::variant_size_v<GameControllerEvent>)
 {
 	auto &prefs = GlobalPrefs::Ref();
 	luaHookTimeout = prefs.Get("LuaHookTimeout", 3000);
@@ -155,6 +158,7 @@ LuaScriptInterface::LuaScriptInterface(GameController *newGameController, GameMo
 	LuaRenderer::Open(L);
 	LuaSimulation::Open(L);
 	LuaSocket::Open(L);
+	LuaWorker::Open(L);
 	{
 		lua_getglobal(L, "os");
 		lua_pushcfunction(L, osExit);
@@ -195,6 +199,9 @@ void LuaScriptInterface::InitCustomCanMove()
 			}
 		}
 	}
+	sd.compile_can_move();
+	// every change to element properties from Lua ends up here
+	sd.compile_transitions();
 }
 
 void CommandInterface::Init()
@@ -378,17 +385,37 @@ static int pushGameControllerEvent(lua_State *L, const GameControllerEvent &even
 bool CommandInterface::HandleEvent(const GameControllerEvent &event)
 {
 	auto *lsi = static_cast<LuaScriptInterface *>(this);
+	auto &profiles = lsi->gameControllerEventHandlerProfiles[event.index()];
+	if (profiles.empty())
+	{
+		// the common case for per-frame events, don't touch the Lua state at all
+		return true;
+	}
 	auto *L = lsi->L;
+	auto traits = std::visit([](auto &event) {
+		return event.traits;
+	}, event);
 	bool cont = true;
 	lsi->gameControllerEventHandlers[event.index()].Push(L);
 	int len = lua_objlen(L, -1);
 	for (int i = 1; i <= len && cont; i++)
 	{
 		lua_rawgeti(L, -1, i);
+		auto *function = lua_topointer(L, -1);
 		int numArgs = pushGameControllerEvent(L, event);
-		int callret = tpt_lua_pcall(L, numArgs, 1, 0, std::visit([](auto &event) {
-			return event.traits;
-		}, event));
+		auto start = std::chrono::steady_clock::now();
+		int callret = tpt_lua_pcall(L, numArgs, 1, 0, traits);
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		// the handler may have (un)registered handlers, so look it up again
+		auto it = std::find_if(profiles.begin(), profiles.end(), [function](auto &profile) {
+			return profile.function == function;
+		});
+		if (it != profiles.end())
+		{
+			it->calls += 1;
+			it->frameTime += elapsed;
+			it->totalTime += elapsed;
+		}
 		if (callret)
 		{
 			if (LuaGetError() == "Error: Script not responding")
@@ -400,6 +427,10 @@ bool CommandInterface::HandleEvent(const GameControllerEvent &event)
 				}
 				lua_pushnil(L);
 				lua_rawseti(L, -3, len);
+				if (i - 1 < int(profiles.size()))
+				{
+					profiles.erase(profiles.begin() + (i - 1));
+				}
 				i--;
 			}
 			Log(CommandInterface::LogError, LuaGetError());
@@ -417,13 +448,42 @@ bool CommandInterface::HandleEvent(const GameControllerEvent &event)
 	return cont;
 }
 
+std::vector<EventHandlerProfile> CommandInterface::GetEventHandlerProfile()
+{
+	auto *lsi = static_cast<LuaScriptInterface *>(this);
+	std::vector<EventHandlerProfile> result;
+	for (auto &profiles : lsi->gameControllerEventHandlerProfiles)
+	{
+		result.insert(result.end(), profiles.begin(), profiles.end());
+	}
+	std::sort(result.begin(), result.end(), [](auto &lhs, auto &rhs) {
+		return lhs.lastFrameTime > rhs.lastFrameTime;
+	});
+	return result;
+}
+
 void CommandInterface::OnTick()
 {
 	auto *lsi = static_cast<LuaScriptInterface *>(this);
+	for (auto &profiles : lsi->gameControllerEventHandlerProfiles)
+	{
+		for (auto &profile : profiles)
+		{
+			profile.lastFrameTime = profile.frameTime;
+			profile.frameTime = 0;
+		}
+	}
 	LuaMisc::Tick(lsi->L);
+	LuaWorker::Tick(lsi->L);
 	HandleEvent(TickEvent{});
 }
 
+void CommandInterface::FlushBatchUpdates()
+{
+	auto *lsi = static_cast<LuaScriptInterface *>(this);
+	LuaElements::FlushBatchUpdates(lsi->L);
+}
+
 int CommandInterface::Command(String command)
 {
 	auto *lsi = static_cast<LuaScriptInterface *>(this);
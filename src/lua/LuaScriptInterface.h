@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <vector>
 
 namespace http
 {
@@ -24,6 +25,11 @@ class Renderer;
 class Simulation;
 class LuaComponent;
 
+namespace LuaWorker
+{
+	struct Worker;
+}
+
 int LuaToLoggableString(lua_State *L, int n);
 String LuaGetError();
 void LuaGetProperty(lua_State *L, StructProperty property, intptr_t propertyAddress);
@@ -56,8 +62,15 @@ struct CustomElement
 	LuaSmartRef create;
 	LuaSmartRef createAllowed;
 	LuaSmartRef changeType;
+	LuaSmartRef batchUpdate;
+	LuaSmartRef batchUpdateIds; // table reused across chunks
+	int batchUpdateChunk = 0;
+	int batchUpdateIdsLen = 0;
+	std::vector<int> batchUpdatePending;
 };
 
+constexpr int defaultBatchUpdateChunk = 4096;
+
 class LuaScriptInterface : public CommandInterface
 {
 	LuaStatePtr luaState;
@@ -84,11 +97,14 @@ public:
 	long unsigned int luaExecutionStart = 0;
 
 	std::vector<LuaSmartRef> gameControllerEventHandlers; // must come after luaState
+	std::vector<std::vector<EventHandlerProfile>> gameControllerEventHandlerProfiles; // parallel to the tables in gameControllerEventHandlers
 	std::unique_ptr<http::Request> scriptManagerDownload;
 	int luaHookTimeout;
 
 	std::map<LuaComponent *, LuaSmartRef> grabbedComponents; // must come after luaState
 
+	std::vector<std::shared_ptr<LuaWorker::Worker>> workers; // must come after luaState
+
 	LuaScriptInterface(GameController *newGameController, GameModel *newGameModel);
 	~LuaScriptInterface();
 
@@ -138,6 +154,7 @@ namespace LuaBz2
 namespace LuaElements
 {
 	void Open(lua_State *L);
+	void FlushBatchUpdates(lua_State *L);
 }
 
 namespace LuaEvent
@@ -181,6 +198,12 @@ namespace LuaSimulation
 	void Open(lua_State *L);
 }
 
+namespace LuaWorker
+{
+	void Open(lua_State *L);
+	void Tick(lua_State *L);
+}
+
 namespace LuaSocket
 {
 	int GetTime(lua_State *L);
@@ -1,8 +1,10 @@
 #include "LuaScriptInterface.h"
+#include "Config.h"
 #include "client/Client.h"
 #include "client/GameSave.h"
 #include "client/SaveFile.h"
 #include "client/SaveInfo.h"
+#include "common/platform/Platform.h"
 #include "Format.h"
 #include "gui/game/GameController.h"
 #include "gui/game/GameModel.h"
@@ -11,9 +13,12 @@
 #include "simulation/Air.h"
 #include "simulation/ElementCommon.h"
 #include "simulation/GOLString.h"
+#include "simulation/Replay.h"
 #include "simulation/gravity/Gravity.h"
 #include "simulation/Snapshot.h"
 #include "simulation/ToolClasses.h"
+#include <algorithm>
+#include <optional>
 #include <type_traits>
 
 static int ambientHeatSim(lua_State *L)
@@ -1165,6 +1170,24 @@ static int airMode(lua_State *L)
 	return 0;
 }
 
+static int heatMode(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	int acount = lua_gettop(L);
+	if (acount == 0)
+	{
+		lua_pushnumber(L, lsi->sim->heatMode);
+		return 1;
+	}
+	int heatMode = luaL_optint(L, 1, HEAT_STOCHASTIC);
+	if (heatMode < 0 || heatMode >= NUM_HEATMODES)
+	{
+		return luaL_error(L, "Invalid heat mode (%d)", heatMode);
+	}
+	lsi->sim->heatMode = heatMode;
+	return 0;
+}
+
 static int waterEqualization(lua_State *L)
 {
 	auto *lsi = GetLSI();
@@ -1222,10 +1245,12 @@ static int canMove(lua_State *L)
 	}
 	else
 	{
-		int setting = luaL_checkint(L, 3) & 0x7F;
+		int setting = luaL_checkint(L, 3);
+		if (setting < 0 || setting > 3)
+			return luaL_error(L, "Invalid move setting (%d)", setting);
 		lsi->customCanMove[movingElement][destinationElement] = setting | 0x80;
 		auto &sd = SimulationData::Ref();
-		sd.can_move[movingElement][destinationElement] = setting;
+		sd.set_can_move(movingElement, destinationElement, setting);
 		return 0;
 	}
 }
@@ -1378,6 +1403,89 @@ static int neighbors(lua_State *L)
 	return 1;
 }
 
+static int neighbourList(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	auto *sim = lsi->sim;
+	int cx = luaL_checkint(L, 1);
+	int cy = luaL_checkint(L, 2);
+	int rx = luaL_optint(L, 3, 2);
+	int ry = luaL_optint(L, 4, 2);
+	int t = luaL_optint(L, 5, PT_NONE);
+	if (rx < 0 || ry < 0)
+	{
+		return luaL_error(L, "Invalid radius");
+	}
+	auto &properties = Particle::GetProperties();
+	std::optional<StructProperty> property;
+	double propertyValue = 0;
+	if (!lua_isnoneornil(L, 6))
+	{
+		int field = luaL_checkint(L, 6);
+		if (field < 0 || field >= int(properties.size()))
+		{
+			return luaL_error(L, "Invalid field ID (%d)", field);
+		}
+		property = properties[field];
+		propertyValue = luaL_checknumber(L, 7);
+	}
+	auto propertyMatches = [&property, propertyValue](const Particle &part) {
+		auto *address = reinterpret_cast<const char *>(&part) + property->Offset;
+		switch (property->Type)
+		{
+		case StructProperty::ParticleType:
+		case StructProperty::Integer:
+			return double(*reinterpret_cast<const int *>(address)) == propertyValue;
+
+		case StructProperty::UInteger:
+			return double(*reinterpret_cast<const unsigned int *>(address)) == propertyValue;
+
+		case StructProperty::Float:
+			return double(*reinterpret_cast<const float *>(address)) == propertyValue;
+
+		default:
+			break;
+		}
+		return false;
+	};
+	// Looked up in pmap and photons over the box on every call, so the result always matches
+	// the simulation as it is right now, edits made while paused or halfway through a frame
+	// included. Like sim.neighbours, this only sees the particle pmap holds for a pixel, not the
+	// ones stacked under it.
+	auto matches = [sim, t, &property, &propertyMatches](int r) {
+		if (!r || (t && TYP(r) != t))
+		{
+			return false;
+		}
+		return !property || propertyMatches(sim->parts[ID(r)]);
+	};
+	int x1 = std::max(cx - rx, 0);
+	int y1 = std::max(cy - ry, 0);
+	int x2 = std::min(cx + rx, XRES - 1);
+	int y2 = std::min(cy + ry, YRES - 1);
+	lua_newtable(L);
+	int count = 0;
+	for (int y = y1; y <= y2; y++)
+	{
+		for (int x = x1; x <= x2; x++)
+		{
+			if (x == cx && y == cy)
+			{
+				continue;
+			}
+			for (auto r : { sim->pmap[y][x], sim->photons[y][x] })
+			{
+				if (matches(r))
+				{
+					lua_pushinteger(L, ID(r));
+					lua_rawseti(L, -2, ++count);
+				}
+			}
+		}
+	}
+	return 1;
+}
+
 static int parts(lua_State *L)
 {
 	lua_pushnumber(L, 0);
@@ -1413,6 +1521,106 @@ static int photons(lua_State *L)
 	return 1;
 }
 
+static ByteString particleCdef()
+{
+	auto properties = Particle::GetProperties();
+	std::sort(properties.begin(), properties.end(), [](auto &lhs, auto &rhs) {
+		return lhs.Offset < rhs.Offset;
+	});
+	ByteString cdef = "typedef struct {";
+	intptr_t offset = 0;
+	auto pad = [&cdef, &offset](intptr_t upTo) {
+		if (upTo > offset)
+		{
+			cdef += ByteString::Build(" uint8_t pad", offset, "[", upTo - offset, "];");
+			offset = upTo;
+		}
+	};
+	for (auto &prop : properties)
+	{
+		const char *ctype = nullptr;
+		intptr_t size = 0;
+		switch (prop.Type)
+		{
+		case StructProperty::ParticleType:
+		case StructProperty::Integer:
+			ctype = "int32_t";
+			size = sizeof(int32_t);
+			break;
+
+		case StructProperty::UInteger:
+			ctype = "uint32_t";
+			size = sizeof(uint32_t);
+			break;
+
+		case StructProperty::Float:
+			ctype = "float";
+			size = sizeof(float);
+			break;
+
+		default:
+			continue;
+		}
+		pad(prop.Offset);
+		cdef += ByteString::Build(" ", ctype, " ", prop.Name, ";");
+		offset += size;
+	}
+	pad(sizeof(Particle));
+	cdef += " } tpt_particle;";
+	return cdef;
+}
+
+static void pushFfiView(lua_State *L, const char *name, void *ptr, const char *ctype, int width, int height, int stride)
+{
+	lua_createtable(L, 0, 5);
+	lua_pushlightuserdata(L, ptr);
+	lua_setfield(L, -2, "ptr");
+	lua_pushstring(L, ctype);
+	lua_setfield(L, -2, "ctype");
+	lua_pushinteger(L, width);
+	lua_setfield(L, -2, "width");
+	lua_pushinteger(L, height);
+	lua_setfield(L, -2, "height");
+	lua_pushinteger(L, stride);
+	lua_setfield(L, -2, "stride");
+	lua_setfield(L, -2, name);
+}
+
+static int ffiViews(lua_State *L)
+{
+	// Pointers handed out here are only valid as long as viewGeneration stays the same; the gravity
+	// maps in particular move around whenever the gravity thread delivers a new result.
+	auto *lsi = GetLSI();
+	auto *sim = lsi->sim;
+	static_assert(sizeof(int) == sizeof(int32_t));
+	lua_newtable(L);
+	lua_pushnumber(L, double(sim->viewGeneration));
+	lua_setfield(L, -2, "generation");
+	tpt_lua_pushByteString(L, particleCdef());
+	lua_setfield(L, -2, "cdef");
+	lua_pushinteger(L, sim->parts_lastActiveIndex);
+	lua_setfield(L, -2, "lastActiveIndex");
+	pushFfiView(L, "parts"      , &sim->parts[0]     , "tpt_particle *", NPART , 1     , NPART );
+	pushFfiView(L, "pmap"       , &sim->pmap[0][0]   , "int32_t *"     , XRES  , YRES  , XRES  );
+	pushFfiView(L, "photons"    , &sim->photons[0][0], "int32_t *"     , XRES  , YRES  , XRES  );
+	pushFfiView(L, "pressure"   , &sim->pv[0][0]     , "float *"       , XCELLS, YCELLS, XCELLS);
+	pushFfiView(L, "velocityX"  , &sim->vx[0][0]     , "float *"       , XCELLS, YCELLS, XCELLS);
+	pushFfiView(L, "velocityY"  , &sim->vy[0][0]     , "float *"       , XCELLS, YCELLS, XCELLS);
+	pushFfiView(L, "ambientHeat", &sim->hv[0][0]     , "float *"       , XCELLS, YCELLS, XCELLS);
+	pushFfiView(L, "gravityX"   , sim->gravx         , "float *"       , XCELLS, YCELLS, XCELLS);
+	pushFfiView(L, "gravityY"   , sim->gravy         , "float *"       , XCELLS, YCELLS, XCELLS);
+	pushFfiView(L, "gravityP"   , sim->gravp         , "float *"       , XCELLS, YCELLS, XCELLS);
+	pushFfiView(L, "gravityMass", sim->gravmap       , "float *"       , XCELLS, YCELLS, XCELLS);
+	return 1;
+}
+
+static int viewGeneration(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	lua_pushnumber(L, double(lsi->sim->viewGeneration));
+	return 1;
+}
+
 static int frameRender(lua_State *L)
 {
 	auto *lsi = GetLSI();
@@ -1864,6 +2072,98 @@ static int ensureDeterminism(lua_State *L)
 	return 1;
 }
 
+static int freezeStillAir(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	if (lua_gettop(L))
+	{
+		lsi->sim->air->freezeStillAir = lua_toboolean(L, 1);
+		if (!lsi->sim->air->freezeStillAir)
+		{
+			lsi->sim->air->Thaw();
+		}
+		return 0;
+	}
+	lua_pushboolean(L, lsi->sim->air->freezeStillAir);
+	return 1;
+}
+
+static std::optional<Replay> loadReplay(lua_State *L, int arg)
+{
+	auto filename = tpt_lua_checkByteString(L, arg);
+	std::vector<char> data;
+	if (!Platform::ReadFile(data, filename))
+	{
+		luaL_error(L, "cannot read %s", filename.c_str());
+	}
+	ByteString error;
+	try
+	{
+		return std::make_optional<Replay>(data);
+	}
+	catch (const ParseException &e)
+	{
+		error = e.what();
+	}
+	luaL_error(L, "cannot load replay: %s", error.c_str());
+	return std::nullopt;
+}
+
+static int recordReplay(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	if (!lua_gettop(L))
+	{
+		lua_pushboolean(L, lsi->gameModel->IsRecordingReplay());
+		return 1;
+	}
+	if (lua_toboolean(L, 1))
+	{
+		auto keyframeInterval = luaL_optinteger(L, 2, 3600);
+		if (keyframeInterval < 1)
+		{
+			return luaL_error(L, "keyframe interval must be at least 1");
+		}
+		lsi->gameModel->StartReplay(uint64_t(keyframeInterval));
+		return 0;
+	}
+	auto filename = tpt_lua_checkByteString(L, 2);
+	auto replay = lsi->gameModel->StopReplay();
+	if (!replay)
+	{
+		return luaL_error(L, "not recording a replay");
+	}
+	lua_pushboolean(L, Platform::WriteFile(replay->Serialise(), filename));
+	return 1;
+}
+
+static int seekReplay(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	auto replay = loadReplay(L, 1);
+	auto frame = luaL_optinteger(L, 2, 0);
+	lsi->gameController->HistorySnapshot();
+	replay->Seek(*lsi->sim, uint64_t(std::max(frame, lua_Integer(0))));
+	lsi->gameModel->UpdateQuickOptions();
+	lua_pushinteger(L, lua_Integer(replay->EndFrame()));
+	return 1;
+}
+
+static int verifyReplay(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	auto replay = loadReplay(L, 1);
+	lsi->gameController->HistorySnapshot();
+	auto mismatch = replay->Verify(*lsi->sim);
+	lsi->gameModel->UpdateQuickOptions();
+	if (!mismatch)
+	{
+		return 0;
+	}
+	lua_pushinteger(L, lua_Integer(*mismatch));
+	return 1;
+}
+
 void LuaSimulation::Open(lua_State *L)
 {
 	auto *lsi = GetLSI();
@@ -1919,6 +2219,7 @@ void LuaSimulation::Open(lua_State *L)
 		LFUNC(gravityMode),
 		LFUNC(customGravity),
 		LFUNC(airMode),
+		LFUNC(heatMode),
 		LFUNC(waterEqualization),
 		LFUNC(ambientAirTemp),
 		LFUNC(elementCount),
@@ -1928,6 +2229,7 @@ void LuaSimulation::Open(lua_State *L)
 		LFUNC(pmap),
 		LFUNC(photons),
 		LFUNC(neighbors),
+		LFUNC(neighbourList),
 		LFUNC(frameRender),
 		LFUNC(golSpeedRatio),
 		LFUNC(takeSnapshot),
@@ -1943,6 +2245,10 @@ void LuaSimulation::Open(lua_State *L)
 		LFUNC(randomSeed),
 		LFUNC(hash),
 		LFUNC(ensureDeterminism),
+		LFUNC(freezeStillAir),
+		LFUNC(recordReplay),
+		LFUNC(seekReplay),
+		LFUNC(verifyReplay),
 		LFUNC(paused),
 		LFUNC(gravityMass),
 		LFUNC(gravityField),
@@ -1960,6 +2266,13 @@ void LuaSimulation::Open(lua_State *L)
 	};
 	lua_newtable(L);
 	luaL_register(L, NULL, reg);
+	if constexpr (LUA_FFI)
+	{
+		lua_pushcfunction(L, ffiViews);
+		lua_setfield(L, -2, "ffiViews");
+		lua_pushcfunction(L, viewGeneration);
+		lua_setfield(L, -2, "viewGeneration");
+	}
 
 #define LCONST(v) lua_pushinteger(L, int(v)); lua_setfield(L, -2, #v)
 #define LCONSTF(v) lua_pushnumber(L, float(v)); lua_setfield(L, -2, #v)
@@ -2034,6 +2347,10 @@ void LuaSimulation::Open(lua_State *L)
 	LCONST(AIR_NOUPDATE);
 	LCONST(NUM_AIRMODES);
 
+	LCONST(HEAT_STOCHASTIC);
+	LCONST(HEAT_FIELD);
+	LCONST(NUM_HEATMODES);
+
 	LCONST(GRAV_VERTICAL);
 	LCONST(GRAV_OFF);
 	LCONST(GRAV_RADIAL);
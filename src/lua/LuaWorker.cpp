@@ -0,0 +1,521 @@
+#include "LuaScriptInterface.h"
+#include "simulation/Simulation.h"
+#include "simulation/Snapshot.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Worker states are completely separate from the main Lua state and from each other. All they get
+// is a copy of the simulation taken when they are spawned, the input value, and a way to post
+// values back, which are delivered to the main state in LuaWorker::Tick, in the order they were posted.
+
+constexpr int maxWorkers = 16;
+constexpr int maxValueDepth = 32;
+
+struct WorkerValue
+{
+	enum Kind
+	{
+		nil,
+		boolean,
+		number,
+		string,
+		table,
+	};
+	Kind kind = nil;
+	bool boolValue = false;
+	double numberValue = 0;
+	ByteString stringValue;
+	std::vector<WorkerValue> keys;
+	std::vector<WorkerValue> values;
+};
+
+namespace LuaWorker
+{
+	struct Worker
+	{
+		ByteString code;
+		WorkerValue input;
+		std::unique_ptr<Snapshot> snapshot;
+		RNG rng;
+		std::thread thread;
+		std::atomic<bool> cancel = false;
+
+		std::mutex messageMx;
+		std::deque<WorkerValue> messages; // protected by messageMx
+		bool done = false; // protected by messageMx
+		ByteString error; // protected by messageMx
+
+		// main thread only
+		LuaSmartRef onMessage;
+		LuaSmartRef onDone;
+		bool finished = false;
+
+		~Worker()
+		{
+			cancel = true;
+			if (thread.joinable())
+			{
+				thread.join();
+			}
+		}
+	};
+}
+using LuaWorker::Worker;
+
+static void toValue(lua_State *L, int index, WorkerValue &value, int depth)
+{
+	if (index < 0)
+	{
+		index = lua_gettop(L) + index + 1;
+	}
+	switch (lua_type(L, index))
+	{
+	case LUA_TNIL:
+		value.kind = WorkerValue::nil;
+		break;
+
+	case LUA_TBOOLEAN:
+		value.kind = WorkerValue::boolean;
+		value.boolValue = lua_toboolean(L, index);
+		break;
+
+	case LUA_TNUMBER:
+		value.kind = WorkerValue::number;
+		value.numberValue = lua_tonumber(L, index);
+		break;
+
+	case LUA_TSTRING:
+		value.kind = WorkerValue::string;
+		value.stringValue = tpt_lua_toByteString(L, index);
+		break;
+
+	case LUA_TTABLE:
+		if (depth >= maxValueDepth)
+		{
+			luaL_error(L, "table nested too deeply");
+		}
+		value.kind = WorkerValue::table;
+		lua_pushnil(L);
+		while (lua_next(L, index))
+		{
+			toValue(L, -2, value.keys.emplace_back(), depth + 1);
+			toValue(L, -1, value.values.emplace_back(), depth + 1);
+			lua_pop(L, 1);
+		}
+		break;
+
+	default:
+		luaL_error(L, "cannot pass a %s to or from a worker", luaL_typename(L, index));
+		break;
+	}
+}
+
+static void pushValue(lua_State *L, const WorkerValue &value)
+{
+	switch (value.kind)
+	{
+	case WorkerValue::nil:
+		lua_pushnil(L);
+		break;
+
+	case WorkerValue::boolean:
+		lua_pushboolean(L, value.boolValue);
+		break;
+
+	case WorkerValue::number:
+		lua_pushnumber(L, value.numberValue);
+		break;
+
+	case WorkerValue::string:
+		tpt_lua_pushByteString(L, value.stringValue);
+		break;
+
+	case WorkerValue::table:
+		lua_createtable(L, 0, int(value.keys.size()));
+		for (auto i = 0U; i < value.keys.size(); ++i)
+		{
+			pushValue(L, value.keys[i]);
+			pushValue(L, value.values[i]);
+			lua_rawset(L, -3);
+		}
+		break;
+	}
+}
+
+// Everything below up to spawn runs on the worker thread, on the worker's own state.
+
+static char workerKey;
+
+static Worker *getWorker(lua_State *L)
+{
+	lua_pushlightuserdata(L, &workerKey);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	auto *worker = (Worker *)lua_touserdata(L, -1);
+	lua_pop(L, 1);
+	return worker;
+}
+
+static void workerHook(lua_State *L, lua_Debug *ar)
+{
+	if (ar->event == LUA_HOOKCOUNT && getWorker(L)->cancel)
+	{
+		luaL_error(L, "cancelled");
+	}
+}
+
+static int workerPost(lua_State *L)
+{
+	auto *worker = getWorker(L);
+	WorkerValue value;
+	toValue(L, 1, value, 0);
+	std::lock_guard lk(worker->messageMx);
+	worker->messages.push_back(std::move(value));
+	return 0;
+}
+
+static int workerRandom(lua_State *L)
+{
+	auto &rng = getWorker(L)->rng;
+	int lower, upper;
+	switch (lua_gettop(L))
+	{
+	case 0:
+		lua_pushnumber(L, rng.uniform01());
+		return 1;
+
+	case 1:
+		lower = 1;
+		upper = luaL_checkinteger(L, 1);
+		break;
+
+	default:
+		lower = luaL_checkinteger(L, 1);
+		upper = luaL_checkinteger(L, 2);
+		break;
+	}
+	if (upper < lower)
+	{
+		luaL_error(L, "interval is empty");
+	}
+	if ((unsigned int)(upper) - (unsigned int)(lower) + 1U)
+	{
+		lua_pushinteger(L, rng.between(lower, upper));
+	}
+	else
+	{
+		lua_pushinteger(L, int(rng()));
+	}
+	return 1;
+}
+
+static int workerRandomseed(lua_State *L)
+{
+	getWorker(L)->rng.seed(luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int snapshotPartCount(lua_State *L)
+{
+	lua_pushinteger(L, int(getWorker(L)->snapshot->Particles.size()));
+	return 1;
+}
+
+static int snapshotPartProperty(lua_State *L)
+{
+	auto &particles = getWorker(L)->snapshot->Particles;
+	int i = luaL_checkinteger(L, 1);
+	if (i < 0 || i >= int(particles.size()) || !particles[i].type)
+	{
+		return 0;
+	}
+	auto &properties = Particle::GetProperties();
+	auto prop = properties.end();
+	if (lua_type(L, 2) == LUA_TNUMBER)
+	{
+		int fieldID = lua_tointeger(L, 2);
+		if (fieldID < 0 || fieldID >= int(properties.size()))
+		{
+			return luaL_error(L, "Invalid field ID (%d)", fieldID);
+		}
+		prop = properties.begin() + fieldID;
+	}
+	else
+	{
+		auto fieldName = tpt_lua_checkByteString(L, 2);
+		prop = std::find_if(properties.begin(), properties.end(), [&fieldName](auto &p) {
+			return p.Name == fieldName;
+		});
+		if (prop == properties.end())
+		{
+			return luaL_error(L, "Invalid field (%s)", fieldName.c_str());
+		}
+	}
+	LuaGetProperty(L, *prop, intptr_t(&particles[i]) + prop->Offset);
+	return 1;
+}
+
+template<class Item, std::vector<Item> Snapshot::*member>
+static int snapshotCell(lua_State *L)
+{
+	auto &map = getWorker(L)->snapshot.get()->*member;
+	int x = luaL_checkinteger(L, 1);
+	int y = luaL_checkinteger(L, 2);
+	if (x < 0 || x >= XCELLS || y < 0 || y >= YCELLS)
+	{
+		return luaL_error(L, "coordinates out of range (%d,%d)", x, y);
+	}
+	lua_pushnumber(L, map[y * XCELLS + x]);
+	return 1;
+}
+
+static int workerMain(lua_State *L)
+{
+	auto *worker = (Worker *)lua_touserdata(L, 1);
+	lua_pushlightuserdata(L, &workerKey);
+	lua_pushlightuserdata(L, worker);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+	luaL_openlibs(L);
+	for (auto name : { "io", "os", "debug", "package", "require", "module", "dofile", "loadfile", "jit", "ffi" })
+	{
+		lua_pushnil(L);
+		lua_setglobal(L, name);
+	}
+	lua_getglobal(L, "math");
+	lua_pushcfunction(L, workerRandom);
+	lua_setfield(L, -2, "random");
+	lua_pushcfunction(L, workerRandomseed);
+	lua_setfield(L, -2, "randomseed");
+	lua_pop(L, 1);
+	lua_pushcfunction(L, workerPost);
+	lua_setglobal(L, "post");
+	pushValue(L, worker->input);
+	lua_setglobal(L, "input");
+	{
+		static const luaL_Reg reg[] = {
+			{ "partCount", snapshotPartCount },
+			{ "partProperty", snapshotPartProperty },
+			{ "pressure", snapshotCell<float, &Snapshot::AirPressure> },
+			{ "velocityX", snapshotCell<float, &Snapshot::AirVelocityX> },
+			{ "velocityY", snapshotCell<float, &Snapshot::AirVelocityY> },
+			{ "ambientHeat", snapshotCell<float, &Snapshot::AmbientHeat> },
+			{ "gravityMass", snapshotCell<float, &Snapshot::GravMap> },
+			{ "wallMap", snapshotCell<unsigned char, &Snapshot::BlockMap> },
+			{ "elecMap", snapshotCell<unsigned char, &Snapshot::ElecMap> },
+			{ NULL, NULL }
+		};
+		lua_newtable(L);
+		luaL_register(L, NULL, reg);
+#define LCONST(v) lua_pushinteger(L, int(v)); lua_setfield(L, -2, #v)
+		LCONST(CELL);
+		LCONST(XCELLS);
+		LCONST(YCELLS);
+		LCONST(XRES);
+		LCONST(YRES);
+		LCONST(NPART);
+#undef LCONST
+		lua_pushnumber(L, double(worker->snapshot->FrameCount));
+		lua_setfield(L, -2, "frame");
+		lua_setglobal(L, "snapshot");
+	}
+	if (luaL_loadbuffer(L, worker->code.data(), worker->code.size(), "=worker"))
+	{
+		return lua_error(L);
+	}
+	lua_call(L, 0, 0);
+	return 0;
+}
+
+static void workerRun(Worker *worker)
+{
+	LuaStatePtr state(luaL_newstate());
+	auto *L = state.get();
+	ByteString error;
+	if (!L)
+	{
+		error = "failed to create Lua state";
+	}
+	else
+	{
+		lua_sethook(L, workerHook, LUA_MASKCOUNT, 1000);
+		lua_pushcfunction(L, workerMain);
+		lua_pushlightuserdata(L, worker);
+		if (lua_pcall(L, 1, 0, 0))
+		{
+			error = lua_isstring(L, -1) ? tpt_lua_toByteString(L, -1) : ByteString("unknown error");
+			if (error.empty())
+			{
+				error = "unknown error";
+			}
+		}
+	}
+	std::lock_guard lk(worker->messageMx);
+	worker->error = error;
+	worker->done = true;
+}
+
+// Main thread from here on.
+
+struct WorkerHandle
+{
+	std::shared_ptr<Worker> worker;
+};
+
+static int spawn(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	auto code = tpt_lua_checkByteString(L, 1);
+	if (!lua_isnoneornil(L, 3))
+	{
+		luaL_checktype(L, 3, LUA_TFUNCTION);
+	}
+	if (!lua_isnoneornil(L, 4))
+	{
+		luaL_checktype(L, 4, LUA_TFUNCTION);
+	}
+	if (int(lsi->workers.size()) >= maxWorkers)
+	{
+		return luaL_error(L, "too many workers running (at most %d)", maxWorkers);
+	}
+	auto worker = std::make_shared<Worker>();
+	worker->code = code;
+	toValue(L, 2, worker->input, 0);
+	worker->snapshot = lsi->sim->CreateSnapshot();
+	worker->rng.state(worker->snapshot->RngState);
+	if (!lua_isnoneornil(L, 3))
+	{
+		worker->onMessage.Assign(L, 3);
+	}
+	if (!lua_isnoneornil(L, 4))
+	{
+		worker->onDone.Assign(L, 4);
+	}
+	worker->thread = std::thread(workerRun, worker.get());
+	lsi->workers.push_back(worker);
+	auto *wh = (WorkerHandle *)lua_newuserdata(L, sizeof(WorkerHandle));
+	new(wh) WorkerHandle{ worker };
+	luaL_newmetatable(L, "LuaWorker");
+	lua_setmetatable(L, -2);
+	return 1;
+}
+
+static int LuaWorker_gc(lua_State *L)
+{
+	auto *wh = (WorkerHandle *)luaL_checkudata(L, 1, "LuaWorker");
+	wh->~WorkerHandle();
+	return 0;
+}
+
+static int LuaWorker_status(lua_State *L)
+{
+	auto *wh = (WorkerHandle *)luaL_checkudata(L, 1, "LuaWorker");
+	if (!wh->worker->finished)
+	{
+		lua_pushliteral(L, "running");
+		return 1;
+	}
+	std::lock_guard lk(wh->worker->messageMx);
+	if (wh->worker->error.size())
+	{
+		lua_pushliteral(L, "failed");
+		tpt_lua_pushByteString(L, wh->worker->error);
+		return 2;
+	}
+	lua_pushliteral(L, "done");
+	return 1;
+}
+
+static int LuaWorker_cancel(lua_State *L)
+{
+	auto *wh = (WorkerHandle *)luaL_checkudata(L, 1, "LuaWorker");
+	wh->worker->cancel = true;
+	return 0;
+}
+
+void LuaWorker::Tick(lua_State *L)
+{
+	auto *lsi = GetLSI();
+	// callbacks may spawn new workers, so iterate over a copy
+	auto workers = lsi->workers;
+	for (auto &worker : workers)
+	{
+		std::deque<WorkerValue> messages;
+		bool done;
+		ByteString error;
+		{
+			std::lock_guard lk(worker->messageMx);
+			std::swap(messages, worker->messages);
+			done = worker->done;
+			error = worker->error;
+		}
+		for (auto &message : messages)
+		{
+			if (worker->onMessage)
+			{
+				worker->onMessage.Push(L);
+				pushValue(L, message);
+				if (tpt_lua_pcall(L, 1, 0, 0, eventTraitNone))
+				{
+					lsi->Log(CommandInterface::LogError, "In worker message handler: " + LuaGetError());
+				}
+			}
+		}
+		if (done)
+		{
+			worker->thread.join();
+			worker->finished = true;
+			if (worker->onDone)
+			{
+				worker->onDone.Push(L);
+				lua_pushboolean(L, error.empty());
+				if (error.empty())
+				{
+					lua_pushnil(L);
+				}
+				else
+				{
+					tpt_lua_pushByteString(L, error);
+				}
+				if (tpt_lua_pcall(L, 2, 0, 0, eventTraitNone))
+				{
+					lsi->Log(CommandInterface::LogError, "In worker completion handler: " + LuaGetError());
+				}
+			}
+		}
+	}
+	lsi->workers.erase(std::remove_if(lsi->workers.begin(), lsi->workers.end(), [](auto &worker) {
+		return worker->finished;
+	}), lsi->workers.end());
+}
+
+void LuaWorker::Open(lua_State *L)
+{
+	{
+		static const luaL_Reg reg[] = {
+#define LFUNC(v) { #v, LuaWorker_ ## v }
+			LFUNC(status),
+			LFUNC(cancel),
+#undef LFUNC
+			{ NULL, NULL }
+		};
+		luaL_newmetatable(L, "LuaWorker");
+		lua_pushcfunction(L, LuaWorker_gc);
+		lua_setfield(L, -2, "__gc");
+		lua_newtable(L);
+		luaL_register(L, NULL, reg);
+		lua_setfield(L, -2, "__index");
+		lua_pop(L, 1);
+	}
+	{
+		static const luaL_Reg reg[] = {
+#define LFUNC(v) { #v, v }
+			LFUNC(spawn),
+#undef LFUNC
+			{ NULL, NULL }
+		};
+		lua_newtable(L);
+		luaL_register(L, NULL, reg);
+		lua_setglobal(L, "worker");
+	}
+}
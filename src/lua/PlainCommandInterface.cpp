@@ -18,11 +18,20 @@ void CommandInterface::Init()
 {
 }
 
+void CommandInterface::FlushBatchUpdates()
+{
+}
+
 bool CommandInterface::HandleEvent(const GameControllerEvent &event)
 {
 	return true;
 }
 
+std::vector<EventHandlerProfile> CommandInterface::GetEventHandlerProfile()
+{
+	return {};
+}
+
 int CommandInterface::Command(String command)
 {
 	return PlainCommand(command);
@@ -31,6 +31,14 @@ void Air::Clear()
 	std::fill(&pv[0][0], &pv[0][0]+NCELL, 0.0f);
 	std::fill(&vy[0][0], &vy[0][0]+NCELL, 0.0f);
 	std::fill(&vx[0][0], &vx[0][0]+NCELL, 0.0f);
+	Thaw();
+}
+
+void Air::Thaw()
+{
+	std::fill(&chunkStillTicks[0][0], &chunkStillTicks[0][0]+YCHUNKS*XCHUNKS, 0);
+	std::fill(&chunkFrozen[0][0], &chunkFrozen[0][0]+YCHUNKS*XCHUNKS, false);
+	frozenChunks = 0;
 }
 
 void Air::ClearAirH()
@@ -115,12 +123,79 @@ void Air::update_airh(void)
 	memcpy(hv, ohv, sizeof(hv));
 }
 
+void Air::update_frozen_chunks(void)
+{
+	for (auto cy = 0; cy < YCHUNKS; cy++)
+	{
+		for (auto cx = 0; cx < XCHUNKS; cx++)
+		{
+			auto isStill = true;
+			auto endY = std::min((cy + 1) * CHUNK, YCELLS);
+			auto endX = std::min((cx + 1) * CHUNK, XCELLS);
+			for (auto y = cy * CHUNK; y < endY && isStill; y++)
+			{
+				for (auto x = cx * CHUNK; x < endX; x++)
+				{
+					if (std::abs(pv[y][x]) >= AIR_STILL || std::abs(vx[y][x]) >= AIR_STILL || std::abs(vy[y][x]) >= AIR_STILL || bmap[y][x] == WL_FAN)
+					{
+						isStill = false;
+						break;
+					}
+				}
+			}
+			chunkStillTicks[cy][cx] = isStill ? std::min(chunkStillTicks[cy][cx] + 1, 255) : 0;
+		}
+	}
+	// a cell in a still chunk has (almost) no velocity, so advection samples it (almost) in place,
+	// and every other pass reads at most one cell away; a chunk surrounded by still chunks thus only
+	// has values below AIR_STILL to pick up this frame. Cells elsewhere may still advect from a frozen
+	// chunk from much farther away, but they read the zeros it holds like any other value.
+	frozenChunks = 0;
+	for (auto cy = 0; cy < YCHUNKS; cy++)
+	{
+		for (auto cx = 0; cx < XCHUNKS; cx++)
+		{
+			auto isFrozen = true;
+			for (auto ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, YCHUNKS - 1); ny++)
+			{
+				for (auto nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, XCHUNKS - 1); nx++)
+				{
+					isFrozen = isFrozen && chunkStillTicks[ny][nx] >= AIR_FREEZE_TICKS;
+				}
+			}
+			if (isFrozen && !chunkFrozen[cy][cx])
+			{
+				// whatever is left is below AIR_STILL, drop it so the chunk stays exactly zero while frozen
+				for (auto y = cy * CHUNK; y < std::min((cy + 1) * CHUNK, YCELLS); y++)
+				{
+					for (auto x = cx * CHUNK; x < std::min((cx + 1) * CHUNK, XCELLS); x++)
+					{
+						pv[y][x] = 0.0f;
+						vx[y][x] = 0.0f;
+						vy[y][x] = 0.0f;
+					}
+				}
+			}
+			chunkFrozen[cy][cx] = isFrozen;
+			if (isFrozen)
+			{
+				frozenChunks++;
+			}
+		}
+	}
+}
+
 void Air::update_air(void)
 {
 	const float advDistanceMult = 0.7f;
 
 	if (airMode != AIR_NOUPDATE) //airMode 4 is no air/pressure update
 	{
+		if (freezeStillAir)
+		{
+			update_frozen_chunks();
+		}
+
 		for (auto i=0; i<YCELLS; i++) //reduces pressure/velocity on the edges every frame
 		{
 			pv[i][0] = pv[i][0]*0.8f;
@@ -156,7 +231,7 @@ void Air::update_air(void)
 		{
 			for (auto i=1; i<XCELLS-1; i++)
 			{
-				if (bmap_blockair[j][i])
+				if (bmap_blockair[j][i] && !frozen(i, j))
 				{
 					vx[j][i] = 0.0f;
 					vx[j][i-1] = 0.0f;
@@ -172,6 +247,10 @@ void Air::update_air(void)
 		{
 			for (auto x=1; x<XCELLS-1; x++)
 			{
+				if (frozen(x, y))
+				{
+					continue;
+				}
 				auto dp = 0.0f;
 				dp += vx[y][x-1] - vx[y][x+1];
 				dp += vy[y-1][x] - vy[y+1][x];
@@ -184,6 +263,10 @@ void Air::update_air(void)
 		{
 			for (auto x=1; x<XCELLS-1; x++)
 			{
+				if (frozen(x, y))
+				{
+					continue;
+				}
 				auto dx = 0.0f;
 				auto dy = 0.0f;
 				dx += pv[y][x-1] - pv[y][x+1];
@@ -203,6 +286,13 @@ void Air::update_air(void)
 		{
 			for (auto x=0; x<XCELLS; x++)
 			{
+				if (frozen(x, y))
+				{
+					ovx[y][x] = 0.0f;
+					ovy[y][x] = 0.0f;
+					opv[y][x] = 0.0f;
+					continue;
+				}
 				auto dx = 0.0f;
 				auto dy = 0.0f;
 				auto dp = 0.0f;
@@ -400,4 +490,5 @@ Air::Air(Simulation & simulation):
 	std::fill(&ohv[0][0], &ohv[0][0]+NCELL, 0.0f);
 	std::fill(&pv[0][0], &pv[0][0]+NCELL, 0.0f);
 	std::fill(&opv[0][0], &opv[0][0]+NCELL, 0.0f);
+	Thaw();
 }
@@ -26,6 +26,24 @@ public:
 	unsigned char bmap_blockair[YCELLS][XCELLS];
 	unsigned char bmap_blockairh[YCELLS][XCELLS];
 	float kernel[9];
+	// If freezeStillAir is set, update_air skips chunks of still air: once a chunk and its neighbours
+	// have had no pressure or velocity above AIR_STILL and no fans for AIR_FREEZE_TICKS frames, it is
+	// zeroed and frozen until activity reaches one of its neighbours again. Dropping what is left
+	// below AIR_STILL changes results, which is why this is off by default.
+	static constexpr int CHUNK = 16; // in cells
+	static constexpr int XCHUNKS = (XCELLS + CHUNK - 1) / CHUNK;
+	static constexpr int YCHUNKS = (YCELLS + CHUNK - 1) / CHUNK;
+	bool freezeStillAir = false;
+	unsigned char chunkStillTicks[YCHUNKS][XCHUNKS];
+	bool chunkFrozen[YCHUNKS][XCHUNKS];
+	int frozenChunks;
+	void update_frozen_chunks(void);
+	// forgets how long chunks have been still, call whenever the air is replaced wholesale
+	void Thaw();
+	bool frozen(int x, int y) const
+	{
+		return chunkFrozen[y / CHUNK][x / CHUNK];
+	}
 	void make_kernel(void);
 	void update_airh(void);
 	void update_air(void);
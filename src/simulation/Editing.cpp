@@ -61,6 +61,7 @@ void Simulation::Restore(const Snapshot &snap)
 	std::copy(snap.BlockAirH      .begin(), snap.BlockAirH      .end(), &air->bmap_blockairh[0][0]);
 	std::copy(snap.FanVelocityX   .begin(), snap.FanVelocityX   .end(), &fvx[0][0]       );
 	std::copy(snap.FanVelocityY   .begin(), snap.FanVelocityY   .end(), &fvy[0][0]       );
+	air->Thaw();
 	if (grav->IsEnabled())
 	{
 		grav->Clear();
@@ -81,6 +82,7 @@ void Simulation::Restore(const Snapshot &snap)
 	parts_lastActiveIndex = NPART - 1;
 	RecalcFreeParticles(false);
 	gravWallChanged = true;
+	viewGeneration += 1;
 }
 
 void Simulation::clear_area(int area_x, int area_y, int area_w, int area_h)
@@ -0,0 +1,200 @@
+#include "HeatField.h"
+#include "Simulation.h"
+#include "SimulationData.h"
+#include "ElementClasses.h"
+#include "Misc.h"
+#include "common/ForEachBand.h"
+#include <algorithm>
+#include <array>
+
+enum HeatPair : uint8_t
+{
+	HEATPAIR_FILT = 1,
+	HEATPAIR_NOFILT = 2, // BRAY, BIZR*, and HSWC with tmp 1
+};
+
+HeatField::HeatField(Simulation &newSim) :
+	sim(newSim),
+	temp(CELLCOUNT),
+	next(CELLCOUNT),
+	conduct(CELLCOUNT),
+	capacity(CELLCOUNT),
+	kind(CELLCOUNT),
+	avoid(CELLCOUNT),
+	rowActive(YRES),
+	rowPaired(YRES),
+	covered(NPART)
+{
+}
+
+void HeatField::MarkPaired(int y)
+{
+	// the pair check is needed wherever this pixel or one of its neighbours is diffused
+	for (auto ny = std::max(y - 1, 0); ny <= std::min(y + 1, YRES - 1); ny++)
+	{
+		rowPaired[ny] = true;
+	}
+}
+
+void HeatField::Gather()
+{
+	auto &sd = SimulationData::CRef();
+	auto &elements = sd.elements;
+	std::fill(conduct.begin(), conduct.end(), 0.0f);
+	std::fill(capacity.begin(), capacity.end(), 1.0f);
+	std::fill(kind.begin(), kind.end(), 0);
+	std::fill(avoid.begin(), avoid.end(), 0);
+	std::fill(rowActive.begin(), rowActive.end(), false);
+	std::fill(rowPaired.begin(), rowPaired.end(), false);
+	std::fill(covered.begin(), covered.end(), false);
+	for (auto y = 0; y < YRES; y++)
+	{
+		for (auto x = 0; x < XRES; x++)
+		{
+			auto r = sim.pmap[y][x];
+			if (!r)
+			{
+				continue;
+			}
+			auto i = ID(r);
+			auto t = TYP(r);
+			auto &part = sim.parts[i];
+			if (!elements[t].HeatConduct || (t == PT_HSWC && part.life != 10))
+			{
+				continue;
+			}
+			auto gelScale = t == PT_GEL ? part.tmp * 2.55f : 1.0f;
+			auto c = Cell(x, y);
+			if constexpr (LATENTHEAT)
+			{
+				// same heat capacity as the LATENTHEAT branch of UpdateParticles uses
+				auto heatCapacity = 96.645f / elements[t].HeatConduct * gelScale * std::fabs(elements[t].Weight);
+				if (!(heatCapacity > 0.0f))
+				{
+					continue;
+				}
+				capacity[c] = heatCapacity;
+			}
+			temp[c] = part.temp;
+			rowActive[y] = true;
+			conduct[c] = std::min(elements[t].HeatConduct * gelScale / 250.0f, 1.0f);
+			if (t == PT_FILT)
+			{
+				kind[c] = HEATPAIR_FILT;
+				avoid[c] = HEATPAIR_NOFILT;
+				MarkPaired(y);
+			}
+			else if (t == PT_BRAY || t == PT_BIZR || t == PT_BIZRG || (t == PT_HSWC && part.tmp == 1))
+			{
+				kind[c] = HEATPAIR_NOFILT;
+				avoid[c] = HEATPAIR_FILT;
+				MarkPaired(y);
+			}
+		}
+	}
+}
+
+void HeatField::DiffuseRow(int y)
+{
+	// with every conductivity at 1 this is the same 3x3 average the stochastic mode applies when it fires
+	constexpr float rate = 1.0f / 9.0f;
+	constexpr int offsets[] = { -STRIDE-1, -STRIDE, -STRIDE+1, -1, 1, STRIDE-1, STRIDE, STRIDE+1 };
+	std::array<float, XRES> flux{};
+	auto row = Cell(0, y);
+	auto *t = &temp[row];
+	auto *k = &conduct[row];
+	auto *cap = &capacity[row];
+	auto *out = &next[row];
+	// one pass per neighbour over contiguous rows keeps these loops free of branches so that they
+	// vectorize; pixels without a conducting particle, including the padding around the grid, have
+	// a conductivity of 0 and exchange nothing
+	for (auto o : offsets)
+	{
+		auto pairFactor = [this, row, o](int x) {
+			return (avoid[row + x] & kind[row + x + o]) ? 0.0f : 1.0f;
+		};
+		auto capacityFactor = [cap, o](int x) {
+			// the smaller of the two capacities keeps the exchange symmetric, so the sum of
+			// capacity times temperature is conserved, and stable, as neither side can move by
+			// more than rate times the difference
+			return std::min(cap[x], cap[x + o]);
+		};
+		if (rowPaired[y])
+		{
+			for (auto x = 0; x < XRES; x++)
+			{
+				auto exchange = pairFactor(x) * std::min(k[x], k[x + o]) * (t[x + o] - t[x]);
+				if constexpr (LATENTHEAT)
+				{
+					exchange *= capacityFactor(x);
+				}
+				flux[x] += exchange;
+			}
+		}
+		else
+		{
+			for (auto x = 0; x < XRES; x++)
+			{
+				auto exchange = std::min(k[x], k[x + o]) * (t[x + o] - t[x]);
+				if constexpr (LATENTHEAT)
+				{
+					exchange *= capacityFactor(x);
+				}
+				flux[x] += exchange;
+			}
+		}
+	}
+	for (auto x = 0; x < XRES; x++)
+	{
+		if constexpr (LATENTHEAT)
+		{
+			out[x] = t[x] + rate * flux[x] / cap[x];
+		}
+		else
+		{
+			out[x] = t[x] + rate * flux[x];
+		}
+	}
+}
+
+void HeatField::Diffuse()
+{
+	// every row only reads temp and writes its own part of next, so bands don't interact
+	ForEachBand(YRES, 32, [this](int, int begin, int end) {
+		for (auto y = begin; y < end; y++)
+		{
+			if (rowActive[y])
+			{
+				DiffuseRow(y);
+			}
+		}
+	});
+}
+
+void HeatField::Scatter()
+{
+	for (auto y = 0; y < YRES; y++)
+	{
+		if (!rowActive[y])
+		{
+			continue;
+		}
+		for (auto x = 0; x < XRES; x++)
+		{
+			auto c = Cell(x, y);
+			if (conduct[c] > 0.0f)
+			{
+				auto i = ID(sim.pmap[y][x]);
+				sim.parts[i].temp = restrict_flt(next[c], MIN_TEMP, MAX_TEMP);
+				covered[i] = true;
+			}
+		}
+	}
+}
+
+void HeatField::Update()
+{
+	Gather();
+	Diffuse();
+	Scatter();
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "SimulationConfig.h"
+#include <cstdint>
+#include <vector>
+
+class Simulation;
+
+// Deterministic replacement for the stochastic particle-to-particle heat conduction in
+// Simulation::UpdateParticles, used in HEAT_FIELD mode. Once per frame, the temperatures of the
+// particles in pmap are gathered into a dense grid, diffused with one explicit step of a fixed
+// 3x3 stencil, split across threads by rows, and scattered back. The grid has a border of
+// non-conducting padding, so pixels on the edges of the simulation take part like any other.
+// Flux between two pixels uses the smaller of their conductivities and is symmetric, so the step
+// conserves the sum of temperatures; like the stochastic mode, it ignores heat capacity (Weight)
+// unless LATENTHEAT is enabled, in which case flux is also scaled by the smaller of the two heat
+// capacities and divided by each pixel's own, which conserves heat. UpdateParticles then only
+// has to check latent heat transitions against each particle's own heat, instead of running the
+// LATENTHEAT neighbour average for every conducting particle every frame. Only the top particle
+// of each pixel takes part; everything else (stacked particles, energy particles and particles
+// created after Update) still conducts in UpdateParticles, see Covered.
+class HeatField
+{
+	static constexpr int STRIDE = XRES + 2;
+	static constexpr int CELLCOUNT = STRIDE * (YRES + 2);
+
+	static int Cell(int x, int y)
+	{
+		return (y + 1) * STRIDE + x + 1;
+	}
+
+	Simulation &sim;
+	std::vector<float> temp;
+	std::vector<float> next;
+	std::vector<float> conduct; // HeatConduct/250, 0 where nothing conducts
+	std::vector<float> capacity; // only used with LATENTHEAT, 1 where nothing conducts
+	std::vector<uint8_t> kind;  // HEATPAIR_* bits of the particle in this pixel
+	std::vector<uint8_t> avoid; // HEATPAIR_* bits of particles this one does not conduct to
+	std::vector<bool> rowActive; // rows with at least one conducting particle
+	std::vector<bool> rowPaired; // rows where kind and avoid have to be checked
+	std::vector<bool> covered; // particles whose temperature was scattered back this frame
+
+	void MarkPaired(int y);
+	void Gather();
+	void DiffuseRow(int y);
+	void Diffuse();
+	void Scatter();
+
+public:
+	HeatField(Simulation &newSim);
+	void Update();
+
+	bool Covered(int i) const
+	{
+		return covered[i];
+	}
+
+	// called when a particle slot gets a new particle
+	void Forget(int i)
+	{
+		covered[i] = false;
+	}
+};
@@ -0,0 +1,609 @@
+#include "Replay.h"
+#include "Simulation.h"
+#include "Snapshot.h"
+#include "Sign.h"
+#include "Air.h"
+#include "gravity/Gravity.h"
+#include "client/GameSave.h"
+#include "common/Defer.h"
+#include "bzip2/bz2wrap.h"
+#include <algorithm>
+#include <cstring>
+
+// * States are flattened into a byte stream: fields of static size first, then the few
+//   simulation options that affect stepping, then particles and signs, so that a change in
+//   particle count only shifts the tail of the stream.
+// * Inputs are lists of (offset, size, bytes) hunks that turn one state stream into another,
+//   which for the usual brush stroke is a few hundred bytes before compression.
+// * Everything is stored in host byte order, as particles and stickmen are copied as is anyway.
+
+namespace
+{
+	constexpr char replayMagic[] = "TPTREPLAY";
+	constexpr uint32_t replayVersion = 3;
+	constexpr size_t hunkMergeGap = 16;
+	constexpr size_t maxStateSize = 256 * 1024 * 1024;
+
+	class Writer
+	{
+		std::vector<char> &data;
+
+	public:
+		Writer(std::vector<char> &newData) : data(newData)
+		{
+		}
+
+		void Bytes(const void *bytes, size_t size)
+		{
+			auto *begin = reinterpret_cast<const char *>(bytes);
+			data.insert(data.end(), begin, begin + size);
+		}
+
+		template<class Item>
+		void Value(Item item)
+		{
+			Bytes(&item, sizeof(item));
+		}
+
+		template<class Item>
+		void Array(const Item *items, size_t count)
+		{
+			Value(uint64_t(count));
+			Bytes(items, count * sizeof(Item));
+		}
+
+		template<class Item>
+		void Vector(const std::vector<Item> &items)
+		{
+			Array(items.data(), items.size());
+		}
+	};
+
+	class Reader
+	{
+		const std::vector<char> &data;
+		size_t pos = 0;
+
+	public:
+		Reader(const std::vector<char> &newData) : data(newData)
+		{
+		}
+
+		const char *Bytes(size_t size)
+		{
+			if (size > data.size() - pos)
+			{
+				throw ParseException(ParseException::Corrupt, "Replay data truncated");
+			}
+			auto *bytes = data.data() + pos;
+			pos += size;
+			return bytes;
+		}
+
+		template<class Item>
+		Item Value()
+		{
+			Item item;
+			std::memcpy(&item, Bytes(sizeof(item)), sizeof(item));
+			return item;
+		}
+
+		template<class Item>
+		std::vector<Item> Vector()
+		{
+			auto count = Value<uint64_t>();
+			if (count > (data.size() - pos) / sizeof(Item))
+			{
+				throw ParseException(ParseException::Corrupt, "Replay data truncated");
+			}
+			std::vector<Item> items(count);
+			std::memcpy(items.data(), Bytes(count * sizeof(Item)), count * sizeof(Item));
+			return items;
+		}
+
+		bool AtEnd() const
+		{
+			return pos == data.size();
+		}
+	};
+
+	std::vector<char> Compress(const std::vector<char> &data)
+	{
+		std::vector<char> compressed;
+		if (BZ2WCompress(compressed, data.data(), data.size()) != BZ2WCompressOk)
+		{
+			throw std::bad_alloc();
+		}
+		return compressed;
+	}
+
+	std::vector<char> Decompress(const std::vector<char> &data)
+	{
+		std::vector<char> decompressed;
+		if (BZ2WDecompress(decompressed, data.data(), data.size(), maxStateSize) != BZ2WDecompressOk)
+		{
+			throw ParseException(ParseException::Corrupt, "Cannot decompress replay data");
+		}
+		return decompressed;
+	}
+
+	// what clear_sim leaves in a slot, which is what most of the particle array looks like
+	Particle UnusedParticle(int i)
+	{
+		Particle part{};
+		part.life = i + 1 < NPART ? i + 1 : -1;
+		return part;
+	}
+
+	// Writes the same fields as Simulation::CreateSnapshot, straight from the simulation, as
+	// this runs twice per frame while recording. particleLimit is the particle count found by
+	// the previous call on the same simulation, or NPART.
+	void CaptureState(const Simulation &sim, std::vector<char> &state, int &particleLimit)
+	{
+		// Snapshots stop at the last active particle, but dead slots past it still link the free
+		// list and decide where new particles go, so take everything up to the last slot ever used.
+		// Slots only ever leave their unused state by becoming active, so there is no need to look
+		// past the previous count or the last active particle, whichever is further.
+		auto particleCount = std::min(std::max(particleLimit, sim.parts_lastActiveIndex + 1), NPART);
+		while (particleCount)
+		{
+			auto unused = UnusedParticle(particleCount - 1);
+			if (std::memcmp(&sim.parts[particleCount - 1], &unused, sizeof(Particle)))
+			{
+				break;
+			}
+			particleCount -= 1;
+		}
+		particleLimit = particleCount;
+		// portal buffers are empty unless portals are in use
+		const Particle empty{};
+		auto *portalParticles = &sim.portalp[0][0][0];
+		auto portalCount = CHANNELS * 8 * 80;
+		while (portalCount && !std::memcmp(&portalParticles[portalCount - 1], &empty, sizeof(Particle)))
+		{
+			portalCount -= 1;
+		}
+
+		state.clear();
+		Writer writer(state);
+		writer.Array(&sim.pv[0][0], NCELL);
+		writer.Array(&sim.vx[0][0], NCELL);
+		writer.Array(&sim.vy[0][0], NCELL);
+		writer.Array(&sim.hv[0][0], NCELL);
+		writer.Array(sim.gravx, NCELL);
+		writer.Array(sim.gravy, NCELL);
+		writer.Array(sim.gravp, NCELL);
+		writer.Array(sim.gravmap, NCELL);
+		writer.Array(&sim.bmap[0][0], NCELL);
+		writer.Array(&sim.emap[0][0], NCELL);
+		writer.Array(&sim.air->bmap_blockair[0][0], NCELL);
+		writer.Array(&sim.air->bmap_blockairh[0][0], NCELL);
+		writer.Array(&sim.fvx[0][0], NCELL);
+		writer.Array(&sim.fvy[0][0], NCELL);
+		writer.Array(portalParticles, portalCount);
+		writer.Array(&sim.wireless[0][0], CHANNELS * 2);
+		writer.Value(uint64_t(MAX_FIGHTERS + 2));
+		writer.Bytes(&sim.fighters[0], sizeof(sim.fighters));
+		writer.Bytes(&sim.player2, sizeof(sim.player2));
+		writer.Bytes(&sim.player, sizeof(sim.player));
+		writer.Value(sim.frameCount);
+		writer.Value(sim.rng.state());
+		writer.Value(int32_t(sim.gravityMode));
+		writer.Value(sim.customGravityX);
+		writer.Value(sim.customGravityY);
+		writer.Value(int32_t(sim.air->airMode));
+		writer.Value(int32_t(sim.heatMode));
+		writer.Value(sim.air->ambientAirTemp);
+		writer.Value(int32_t(sim.edgeMode));
+		writer.Value(int32_t(sim.legacy_enable));
+		writer.Value(int32_t(sim.water_equal_test));
+		writer.Value(int32_t(sim.aheat_enable));
+		// frames stepped while paused (particle debugging, sim.updateUpTo) skip air and gravity
+		writer.Value(int32_t(sim.sys_pause));
+		writer.Value(int32_t(sim.framerender));
+		writer.Value(uint8_t(sim.grav->IsEnabled()));
+		writer.Value(int32_t(sim.parts_lastActiveIndex));
+		writer.Value(uint8_t(sim.force_stacking_check));
+		writer.Value(uint8_t(sim.air->freezeStillAir));
+		writer.Array(&sim.air->chunkStillTicks[0][0], Air::YCHUNKS * Air::XCHUNKS);
+		writer.Array(&sim.air->chunkFrozen[0][0], Air::YCHUNKS * Air::XCHUNKS);
+		writer.Array(sim.parts, particleCount);
+		writer.Value(uint64_t(sim.signs.size()));
+		for (auto &sign : sim.signs)
+		{
+			auto text = sign.text.ToUtf8();
+			writer.Value(int32_t(sign.x));
+			writer.Value(int32_t(sign.y));
+			writer.Value(int32_t(sign.ju));
+			writer.Value(uint64_t(text.size()));
+			writer.Bytes(text.data(), text.size());
+		}
+	}
+
+	void RestoreState(Simulation &sim, const std::vector<char> &state)
+	{
+		Snapshot snap;
+		Reader reader(state);
+		auto staticVector = [&reader](auto &items, size_t size) {
+			items = reader.Vector<typename std::remove_reference_t<decltype(items)>::value_type>();
+			if (items.size() != size)
+			{
+				throw ParseException(ParseException::InvalidDimensions, "Replay recorded with a different simulation size");
+			}
+		};
+		staticVector(snap.AirPressure    , NCELL);
+		staticVector(snap.AirVelocityX   , NCELL);
+		staticVector(snap.AirVelocityY   , NCELL);
+		staticVector(snap.AmbientHeat    , NCELL);
+		staticVector(snap.GravVelocityX  , NCELL);
+		staticVector(snap.GravVelocityY  , NCELL);
+		staticVector(snap.GravValue      , NCELL);
+		staticVector(snap.GravMap        , NCELL);
+		staticVector(snap.BlockMap       , NCELL);
+		staticVector(snap.ElecMap        , NCELL);
+		staticVector(snap.BlockAir       , NCELL);
+		staticVector(snap.BlockAirH      , NCELL);
+		staticVector(snap.FanVelocityX   , NCELL);
+		staticVector(snap.FanVelocityY   , NCELL);
+		snap.PortalParticles = reader.Vector<Particle>();
+		if (snap.PortalParticles.size() > CHANNELS * 8 * 80)
+		{
+			throw ParseException(ParseException::InvalidDimensions, "Replay recorded with a different simulation size");
+		}
+		snap.PortalParticles.resize(CHANNELS * 8 * 80);
+		staticVector(snap.WirelessData   , CHANNELS * 2);
+		staticVector(snap.stickmen       , MAX_FIGHTERS + 2);
+		snap.FrameCount = reader.Value<uint64_t>();
+		snap.RngState = reader.Value<RNG::State>();
+		sim.gravityMode = reader.Value<int32_t>();
+		sim.customGravityX = reader.Value<float>();
+		sim.customGravityY = reader.Value<float>();
+		sim.air->airMode = reader.Value<int32_t>();
+		sim.heatMode = reader.Value<int32_t>();
+		sim.air->ambientAirTemp = reader.Value<float>();
+		sim.edgeMode = reader.Value<int32_t>();
+		sim.legacy_enable = reader.Value<int32_t>();
+		sim.water_equal_test = reader.Value<int32_t>();
+		sim.aheat_enable = reader.Value<int32_t>();
+		sim.sys_pause = reader.Value<int32_t>();
+		sim.framerender = reader.Value<int32_t>();
+		auto gravityEnable = bool(reader.Value<uint8_t>());
+		auto lastActiveIndex = reader.Value<int32_t>();
+		auto forceStackingCheck = bool(reader.Value<uint8_t>());
+		auto freezeStillAir = bool(reader.Value<uint8_t>());
+		auto chunkStillTicks = reader.Vector<unsigned char>();
+		auto chunkFrozen = reader.Vector<uint8_t>();
+		if (chunkStillTicks.size() != Air::YCHUNKS * Air::XCHUNKS || chunkFrozen.size() != Air::YCHUNKS * Air::XCHUNKS)
+		{
+			throw ParseException(ParseException::InvalidDimensions, "Replay recorded with a different simulation size");
+		}
+		snap.Particles = reader.Vector<Particle>();
+		if (snap.Particles.size() > NPART || lastActiveIndex < 0 || lastActiveIndex >= NPART)
+		{
+			throw ParseException(ParseException::InvalidDimensions, "Replay recorded with a different simulation size");
+		}
+		auto signCount = reader.Value<uint64_t>();
+		for (uint64_t i = 0; i < signCount; ++i)
+		{
+			auto x = reader.Value<int32_t>();
+			auto y = reader.Value<int32_t>();
+			auto ju = reader.Value<int32_t>();
+			auto textSize = reader.Value<uint64_t>();
+			auto *text = reader.Bytes(textSize);
+			if (ju < 0 || ju >= sign::Max)
+			{
+				throw ParseException(ParseException::Corrupt, "Invalid sign justification");
+			}
+			snap.signs.push_back(sign(ByteString(text, text + textSize).FromUtf8(), x, y, sign::Justification(ju)));
+		}
+		if (!reader.AtEnd())
+		{
+			throw ParseException(ParseException::Corrupt, "Trailing replay data");
+		}
+		// Restore only brings back gravity fields if gravity is already running
+		if (gravityEnable && !sim.grav->IsEnabled())
+		{
+			sim.grav->start_grav_async();
+		}
+		else if (!gravityEnable && sim.grav->IsEnabled())
+		{
+			sim.grav->stop_grav_async();
+		}
+		sim.Restore(snap);
+		// Restore is meant for undo and rebuilds the free list and stacking check from scratch,
+		// which steps differently from the run being replayed
+		std::copy(snap.Particles.begin(), snap.Particles.end(), sim.parts);
+		for (auto i = int(snap.Particles.size()); i < NPART; ++i)
+		{
+			sim.parts[i] = UnusedParticle(i);
+		}
+		sim.parts_lastActiveIndex = lastActiveIndex;
+		sim.force_stacking_check = forceStackingCheck;
+		// so is the still air tracking, which Restore resets
+		sim.air->freezeStillAir = freezeStillAir;
+		std::copy(chunkStillTicks.begin(), chunkStillTicks.end(), &sim.air->chunkStillTicks[0][0]);
+		std::transform(chunkFrozen.begin(), chunkFrozen.end(), &sim.air->chunkFrozen[0][0], [](uint8_t frozen) {
+			return bool(frozen);
+		});
+		sim.air->frozenChunks = int(std::count_if(chunkFrozen.begin(), chunkFrozen.end(), [](uint8_t frozen) {
+			return frozen;
+		}));
+	}
+
+	std::vector<char> DiffStates(const std::vector<char> &from, const std::vector<char> &to)
+	{
+		std::vector<char> diff;
+		Writer writer(diff);
+		writer.Value(uint64_t(to.size()));
+		auto differs = [&from, &to](size_t i) {
+			return i >= from.size() || from[i] != to[i];
+		};
+		size_t i = 0;
+		while (i < to.size())
+		{
+			if (!differs(i))
+			{
+				i += 1;
+				continue;
+			}
+			// short runs of identical bytes are cheaper to include than to start a new hunk over
+			auto begin = i;
+			auto end = i + 1;
+			for (i = end; i < to.size() && i - end < hunkMergeGap; ++i)
+			{
+				if (differs(i))
+				{
+					end = i + 1;
+				}
+			}
+			writer.Value(uint64_t(begin));
+			writer.Value(uint64_t(end - begin));
+			writer.Bytes(to.data() + begin, end - begin);
+			i = end;
+		}
+		return diff;
+	}
+
+	std::vector<char> PatchState(std::vector<char> state, const std::vector<char> &diff)
+	{
+		Reader reader(diff);
+		auto size = reader.Value<uint64_t>();
+		if (size > maxStateSize)
+		{
+			throw ParseException(ParseException::Corrupt, "Invalid replay input");
+		}
+		state.resize(size);
+		while (!reader.AtEnd())
+		{
+			auto offset = reader.Value<uint64_t>();
+			auto count = reader.Value<uint64_t>();
+			if (offset > size || count > size - offset)
+			{
+				throw ParseException(ParseException::Corrupt, "Invalid replay input");
+			}
+			std::memcpy(state.data() + offset, reader.Bytes(count), count);
+		}
+		return state;
+	}
+
+	void StepFrame(Simulation &sim)
+	{
+		sim.BeforeSim();
+		sim.UpdateParticles(0, NPART);
+		sim.AfterSim();
+	}
+}
+
+Replay::Replay(const std::vector<char> &data)
+{
+	Reader reader(data);
+	if (std::memcmp(reader.Bytes(sizeof(replayMagic)), replayMagic, sizeof(replayMagic)))
+	{
+		throw ParseException(ParseException::Corrupt, "Not a replay");
+	}
+	if (reader.Value<uint32_t>() != replayVersion)
+	{
+		throw ParseException(ParseException::WrongVersion, "Replay format from a different version");
+	}
+	if (reader.Value<uint32_t>() != sizeof(Particle) || reader.Value<uint32_t>() != sizeof(playerst))
+	{
+		throw ParseException(ParseException::WrongVersion, "Replay recorded by an incompatible build");
+	}
+	keyframeInterval = reader.Value<uint64_t>();
+	endFrame = reader.Value<uint64_t>();
+	auto keyframeCount = reader.Value<uint64_t>();
+	for (uint64_t i = 0; i < keyframeCount; ++i)
+	{
+		auto frame = reader.Value<uint64_t>();
+		if (keyframes.size() ? frame <= keyframes.back().frame : frame != 0)
+		{
+			throw ParseException(ParseException::Corrupt, "Invalid replay keyframe");
+		}
+		keyframes.push_back({ frame, reader.Vector<char>() });
+	}
+	auto inputCount = reader.Value<uint64_t>();
+	for (uint64_t i = 0; i < inputCount; ++i)
+	{
+		auto frame = reader.Value<uint64_t>();
+		if (inputs.size() && frame <= inputs.back().frame)
+		{
+			throw ParseException(ParseException::Corrupt, "Invalid replay input");
+		}
+		inputs.push_back({ frame, reader.Vector<char>() });
+	}
+	if (!reader.AtEnd() || keyframes.empty())
+	{
+		throw ParseException(ParseException::Corrupt, "Invalid replay");
+	}
+}
+
+std::vector<char> Replay::Serialise()
+{
+	FinishKeyframe();
+	std::vector<char> data;
+	Writer writer(data);
+	writer.Bytes(replayMagic, sizeof(replayMagic));
+	writer.Value(replayVersion);
+	writer.Value(uint32_t(sizeof(Particle)));
+	writer.Value(uint32_t(sizeof(playerst)));
+	writer.Value(keyframeInterval);
+	writer.Value(endFrame);
+	writer.Value(uint64_t(keyframes.size()));
+	for (auto &keyframe : keyframes)
+	{
+		writer.Value(keyframe.frame);
+		writer.Vector(keyframe.data);
+	}
+	writer.Value(uint64_t(inputs.size()));
+	for (auto &input : inputs)
+	{
+		writer.Value(input.frame);
+		writer.Vector(input.data);
+	}
+	return data;
+}
+
+Replay::~Replay()
+{
+	if (keyframeThread.joinable())
+	{
+		keyframeThread.join();
+	}
+}
+
+void Replay::AddKeyframe(const std::vector<char> &newState)
+{
+	FinishKeyframe();
+	keyframes.push_back({ endFrame, {} });
+	keyframeState = newState;
+	keyframeThread = std::thread([this, data = &keyframes.back().data]() {
+		try
+		{
+			*data = Compress(keyframeState);
+		}
+		catch (const std::bad_alloc &)
+		{
+			keyframeFailed = true;
+		}
+	});
+}
+
+void Replay::FinishKeyframe()
+{
+	if (keyframeThread.joinable())
+	{
+		keyframeThread.join();
+	}
+	if (keyframeFailed)
+	{
+		// playback only gets slower without it, as long as the first keyframe is there
+		keyframeFailed = false;
+		if (keyframes.size() > 1)
+		{
+			keyframes.pop_back();
+		}
+	}
+}
+
+void Replay::BeforeFrame(const Simulation &sim)
+{
+	CaptureState(sim, state, particleLimit);
+	if (keyframes.empty())
+	{
+		AddKeyframe(state);
+	}
+	else if (state != lastState)
+	{
+		inputs.push_back({ endFrame, Compress(DiffStates(lastState, state)) });
+	}
+}
+
+void Replay::AfterFrame(const Simulation &sim)
+{
+	if (keyframes.empty())
+	{
+		// recording started halfway through a frame, it begins with the next one
+		return;
+	}
+	endFrame += 1;
+	CaptureState(sim, lastState, particleLimit);
+	if (endFrame - keyframes.back().frame >= keyframeInterval)
+	{
+		AddKeyframe(lastState);
+	}
+}
+
+template<class Visit>
+void Replay::Play(Simulation &sim, std::vector<Keyframe>::const_iterator keyframe, uint64_t frame, Visit visit)
+{
+	auto input = std::lower_bound(inputs.begin(), inputs.end(), keyframe->frame, [](const Input &input, uint64_t frame) {
+		return input.frame < frame;
+	});
+	// the pause state is part of the recorded state and is applied along with it, so frames
+	// stepped while paused are stepped the same way here; nothing flushes the script interface's
+	// queued updates between the frames stepped here, and scripts would see frames that are not
+	// really happening, so elements also run without Lua callbacks
+	Defer restoreFlags([&sim, sysPause = sim.sys_pause, framerender = sim.framerender, useLuaCallbacks = sim.useLuaCallbacks]() {
+		sim.sys_pause = sysPause;
+		sim.framerender = framerender;
+		sim.useLuaCallbacks = useLuaCallbacks;
+	});
+	sim.useLuaCallbacks = false;
+	RestoreState(sim, Decompress(keyframe->data));
+	for (auto current = keyframe->frame; current < frame; ++current)
+	{
+		for (; input != inputs.end() && input->frame == current; ++input)
+		{
+			auto particleLimit = NPART;
+			CaptureState(sim, state, particleLimit);
+			RestoreState(sim, PatchState(state, Decompress(input->data)));
+		}
+		StepFrame(sim);
+		if (!visit(current + 1))
+		{
+			break;
+		}
+	}
+}
+
+void Replay::Seek(Simulation &sim, uint64_t frame)
+{
+	FinishKeyframe();
+	if (keyframes.empty())
+	{
+		return;
+	}
+	frame = std::min(frame, endFrame);
+	auto keyframe = std::upper_bound(keyframes.cbegin(), keyframes.cend(), frame, [](uint64_t frame, const Keyframe &keyframe) {
+		return frame < keyframe.frame;
+	}) - 1;
+	Play(sim, keyframe, frame, [](uint64_t) {
+		return true;
+	});
+}
+
+std::optional<uint64_t> Replay::Verify(Simulation &sim)
+{
+	FinishKeyframe();
+	if (keyframes.empty())
+	{
+		return std::nullopt;
+	}
+	std::optional<uint64_t> mismatch;
+	auto next = keyframes.cbegin() + 1;
+	Play(sim, keyframes.cbegin(), endFrame, [this, &sim, &mismatch, &next](uint64_t frame) {
+		if (next != keyframes.cend() && next->frame == frame)
+		{
+			auto particleLimit = NPART;
+			CaptureState(sim, state, particleLimit);
+			if (state != Decompress(next->data))
+			{
+				mismatch = frame;
+				return false;
+			}
+			++next;
+		}
+		return true;
+	});
+	return mismatch;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "SimulationConfig.h"
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class Simulation;
+
+// A replay is a sequence of periodic keyframes plus the edits made between
+// frames. Edits of any origin (tools, Lua, pasting, undo) are recorded as
+// differences between the state right after a frame and the state right
+// before the next one, so playback needs neither the UI nor scripts that
+// only edit the simulation between frames. Playback steps frames with Lua
+// callbacks turned off, so elements with scripted behaviour (update,
+// graphics or creation callbacks) do not replay faithfully; Verify reports
+// such replays as diverged. Whether the simulation was paused is recorded
+// with the rest of its state, so frames stepped while paused, which skip air
+// and gravity, play back the same way. Frame numbers count frames stepped
+// since recording started. Particle data is stored in its in-memory layout,
+// so replays only load in builds with the same layout; they are a debugging
+// aid, not a save format.
+class Replay
+{
+public:
+	struct Keyframe
+	{
+		uint64_t frame;
+		std::vector<char> data;
+	};
+
+	struct Input
+	{
+		uint64_t frame; // applied before stepping this frame
+		std::vector<char> data;
+	};
+
+	uint64_t keyframeInterval = 3600;
+
+	Replay() = default;
+	Replay(const std::vector<char> &data);
+	~Replay();
+	std::vector<char> Serialise();
+
+	// Called by whatever steps the simulation, right before and right after
+	// a frame is stepped, with nothing modifying the simulation in between.
+	void BeforeFrame(const Simulation &sim);
+	void AfterFrame(const Simulation &sim);
+
+	uint64_t EndFrame() const
+	{
+		return endFrame;
+	}
+
+	// Restores the nearest keyframe at or before frame and steps forward to it.
+	void Seek(Simulation &sim, uint64_t frame);
+
+	// Plays the whole replay back from the first keyframe and returns the
+	// first keyframe that was not reproduced exactly, if any.
+	std::optional<uint64_t> Verify(Simulation &sim);
+
+private:
+	std::vector<Keyframe> keyframes;
+	std::vector<Input> inputs;
+	uint64_t endFrame = 0;
+	std::vector<char> lastState, state;
+	int particleLimit = NPART;
+
+	// keyframes are big enough to cause a visible hitch when compressed on
+	// the simulation thread, so the newest one is compressed on its own
+	std::thread keyframeThread;
+	std::vector<char> keyframeState;
+	bool keyframeFailed = false;
+	void AddKeyframe(const std::vector<char> &newState);
+	void FinishKeyframe();
+
+	template<class Visit>
+	void Play(Simulation &sim, std::vector<Keyframe>::const_iterator keyframe, uint64_t frame, Visit visit);
+};
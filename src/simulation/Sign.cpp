@@ -3,6 +3,7 @@
 #include "graphics/Graphics.h"
 #include "Simulation.h"
 #include "SimulationData.h"
+#include <cstring>
 
 sign::sign(String text_, int x_, int y_, Justification justification_):
 	x(x_),
@@ -12,106 +13,67 @@ sign::sign(String text_, int x_, int y_, Justification justification_):
 {
 }
 
-String sign::getDisplayText(const Simulation *sim, int &x0, int &y0, int &w, int &h, bool colorize, bool *v95) const
+void sign::parse() const
 {
-	auto &sd = SimulationData::CRef();
-	String drawable_text;
-	auto si = std::make_pair(0, Type::Normal);
+	parsed = true;
+	parsedText = text;
+	parsedSplit = std::make_pair(0, Type::Normal);
+	segments.clear();
+	hasFields = false;
+	sampled = false;
 	if (text.find('{') == text.npos)
 	{
-		drawable_text = text;
+		lastText = text;
 	}
 	else
 	{
-		si = split();
-		if (si.first)
+		parsedSplit = split();
+		if (parsedSplit.first)
 		{
-			drawable_text = text.Between(si.first + 1, text.size() - 1);
+			lastText = text.Between(parsedSplit.first + 1, text.size() - 1);
 		}
 		else
 		{
-			Particle const *part = nullptr;
-			float pressure = 0.0f;
-			float aheat = 0.0f;
-			if (sim && x >= 0 && x < XRES && y >= 0 && y < YRES)
-			{
-				if (sim->photons[y][x])
-				{
-					part = &(sim->parts[ID(sim->photons[y][x])]);
-				}
-				else if (sim->pmap[y][x])
-				{
-					part = &(sim->parts[ID(sim->pmap[y][x])]);
-				}
-				pressure = sim->pv[y/CELL][x/CELL];
-				aheat = sim->hv[y/CELL][x/CELL] - 273.15f;
-			}
-
 			String remaining_text = text;
-			StringBuilder formatted_text;
+			StringBuilder literal;
 			while (auto split_left_curly = remaining_text.SplitBy('{'))
 			{
 				String after_left_curly = split_left_curly.After();
 				if (auto split_right_curly = after_left_curly.SplitBy('}'))
 				{
-					formatted_text << split_left_curly.Before();
+					literal << split_left_curly.Before();
 					remaining_text = split_right_curly.After();
 					String between_curlies = split_right_curly.Before();
+					auto field = FieldNone;
 					if (between_curlies == "t" || between_curlies == "temp")
-					{
-						formatted_text << Format::Precision(Format::ShowPoint(part ? part->temp - 273.15f : 0.0f), 2);
-						// * We would really only need to do this if the sign used the new
-						//   keyword "temp" or if the text was more than just "{t}", but 95.0
-						//   upgrades such signs at load time anyway.
-						// * The same applies to "{p}" and "{aheat}" signs.
-						if (v95)
-							*v95 = true;
-					}
+						field = FieldTemp;
 					else if (between_curlies == "p" || between_curlies == "pres")
-					{
-						formatted_text << Format::Precision(Format::ShowPoint(pressure), 2);
-						if (v95)
-							*v95 = true;
-					}
+						field = FieldPressure;
 					else if (between_curlies == "a" || between_curlies == "aheat")
-					{
-						formatted_text << Format::Precision(Format::ShowPoint(aheat), 2);
-						if (v95)
-							*v95 = true;
-					}
+						field = FieldAheat;
 					else if (between_curlies == "type")
-					{
-						formatted_text << (part ? sd.BasicParticleInfo(*part) : (formatted_text.Size() ? String::Build("empty") : String::Build("Empty")));
-						if (v95)
-							*v95 = true;
-					}
+						field = FieldType;
 					else if (between_curlies == "ctype")
-					{
-						formatted_text << (part ? (sd.IsElementOrNone(part->ctype) ? sd.ElementResolve(part->ctype, -1) : String::Build(part->ctype)) : (formatted_text.Size() ? String::Build("empty") : String::Build("Empty")));
-						if (v95)
-							*v95 = true;
-					}
+						field = FieldCtype;
 					else if (between_curlies == "life")
-					{
-						formatted_text << (part ? part->life : 0);
-						if (v95)
-							*v95 = true;
-					}
+						field = FieldLife;
 					else if (between_curlies == "tmp")
-					{
-						formatted_text << (part ? part->tmp : 0);
-						if (v95)
-							*v95 = true;
-					}
+						field = FieldTmp;
 					else if (between_curlies == "tmp2")
+						field = FieldTmp2;
+					if (field == FieldNone)
 					{
-						formatted_text << (part ? part->tmp2 : 0);
-						if (v95)
-							*v95 = true;
+						literal << '{' << between_curlies << '}';
 					}
 					else
 					{
-						formatted_text << '{' << between_curlies << '}';
+						segments.push_back({ literal.Build(), field });
+						literal = StringBuilder();
+						// * We would really only need to report v95 if the sign used the new
+						//   keyword "temp" or if the text was more than just "{t}", but 95.0
+						//   upgrades such signs at load time anyway.
+						// * The same applies to "{p}" and "{aheat}" signs.
+						hasFields = true;
 					}
 				}
 				else
@@ -119,14 +81,111 @@ String sign::getDisplayText(const Simulation *sim, int &x0, int &y0, int &w, int
 					break;
 				}
 			}
-			formatted_text << remaining_text;
-			drawable_text = formatted_text.Build();
+			literal << remaining_text;
+			if (hasFields)
+			{
+				segments.push_back({ literal.Build(), FieldNone });
+			}
+			else
+			{
+				lastText = literal.Build();
+			}
+		}
+	}
+	if (!hasFields)
+	{
+		lastWidth = Graphics::TextSize(lastText).X + 4;
+	}
+}
+
+String sign::getDisplayText(const Simulation *sim, int &x0, int &y0, int &w, int &h, bool colorize, bool *v95) const
+{
+	if (!parsed || parsedText != text)
+	{
+		parse();
+	}
+	if (hasFields)
+	{
+		if (v95)
+			*v95 = true;
+		// compared with memcmp, so padding has to be zero too
+		Sample sample;
+		std::memset(&sample, 0, sizeof(Sample));
+		Particle const *part = nullptr;
+		if (sim && x >= 0 && x < XRES && y >= 0 && y < YRES)
+		{
+			if (sim->photons[y][x])
+			{
+				part = &(sim->parts[ID(sim->photons[y][x])]);
+			}
+			else if (sim->pmap[y][x])
+			{
+				part = &(sim->parts[ID(sim->pmap[y][x])]);
+			}
+			sample.pressure = sim->pv[y/CELL][x/CELL];
+			sample.aheat = sim->hv[y/CELL][x/CELL] - 273.15f;
+		}
+		if (part)
+		{
+			sample.hasPart = true;
+			sample.part = *part;
+		}
+		if (!sampled || std::memcmp(&sample, &lastSample, sizeof(Sample)))
+		{
+			auto &sd = SimulationData::CRef();
+			StringBuilder formatted_text;
+			for (auto &segment : segments)
+			{
+				formatted_text << segment.literal;
+				switch (segment.field)
+				{
+				case FieldNone:
+					break;
+
+				case FieldTemp:
+					formatted_text << Format::Precision(Format::ShowPoint(part ? part->temp - 273.15f : 0.0f), 2);
+					break;
+
+				case FieldPressure:
+					formatted_text << Format::Precision(Format::ShowPoint(sample.pressure), 2);
+					break;
+
+				case FieldAheat:
+					formatted_text << Format::Precision(Format::ShowPoint(sample.aheat), 2);
+					break;
+
+				case FieldType:
+					formatted_text << (part ? sd.BasicParticleInfo(*part) : (formatted_text.Size() ? String::Build("empty") : String::Build("Empty")));
+					break;
+
+				case FieldCtype:
+					formatted_text << (part ? (sd.IsElementOrNone(part->ctype) ? sd.ElementResolve(part->ctype, -1) : String::Build(part->ctype)) : (formatted_text.Size() ? String::Build("empty") : String::Build("Empty")));
+					break;
+
+				case FieldLife:
+					formatted_text << (part ? part->life : 0);
+					break;
+
+				case FieldTmp:
+					formatted_text << (part ? part->tmp : 0);
+					break;
+
+				case FieldTmp2:
+					formatted_text << (part ? part->tmp2 : 0);
+					break;
+				}
+			}
+			lastText = formatted_text.Build();
+			lastWidth = Graphics::TextSize(lastText).X + 4;
+			std::memcpy(&lastSample, &sample, sizeof(Sample));
+			sampled = true;
 		}
 	}
 
+	String drawable_text = lastText;
 	if (colorize)
 	{
-		switch (si.second)
+		switch (parsedSplit.second)
 		{
 		case Normal: break;
 		case Save:   drawable_text = "\bt" + drawable_text; break;
@@ -136,7 +195,8 @@ String sign::getDisplayText(const Simulation *sim, int &x0, int &y0, int &w, int
 		}
 	}
 
-	w = Graphics::TextSize(drawable_text.c_str()).X + 4;
+	// colour codes take up no space, so the width is the same either way
+	w = lastWidth;
 	h = 15;
 	x0 = (ju == Right) ? x - w : (ju == Left) ? x : x - w/2;
 	y0 = (y > 18) ? y - 18 : y + 4;
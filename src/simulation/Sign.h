@@ -1,6 +1,8 @@
 #pragma once
 #include "common/String.h"
+#include "Particle.h"
 #include <utility>
+#include <vector>
 
 class Simulation;
 
@@ -31,4 +33,47 @@ struct sign
 	sign(String text_, int x_, int y_, Justification justification_);
 	String getDisplayText(const Simulation *sim, int &x, int &y, int &w, int &h, bool colorize = true, bool *v95 = nullptr) const;
 	std::pair<int, Type> split() const;
+
+private:
+	enum Field
+	{
+		FieldNone,
+		FieldTemp,
+		FieldPressure,
+		FieldAheat,
+		FieldType,
+		FieldCtype,
+		FieldLife,
+		FieldTmp,
+		FieldTmp2,
+	};
+
+	struct Segment
+	{
+		String literal;
+		Field field; // appended after literal
+	};
+
+	struct Sample
+	{
+		bool hasPart;
+		Particle part;
+		float pressure;
+		float aheat;
+	};
+
+	// Filled in by getDisplayText: text as literals and live fields, reparsed whenever text
+	// changes, and the last display text with the values it was built from, which is reused
+	// until one of them changes.
+	mutable String parsedText;
+	mutable bool parsed = false;
+	mutable std::pair<int, Type> parsedSplit;
+	mutable std::vector<Segment> segments; // empty if the display text does not depend on the simulation
+	mutable bool hasFields;
+	mutable bool sampled;
+	mutable Sample lastSample;
+	mutable String lastText;
+	mutable int lastWidth;
+
+	void parse() const;
 };
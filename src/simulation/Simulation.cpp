@@ -1,10 +1,12 @@
 #include "Simulation.h"
 #include "Air.h"
+#include "HeatField.h"
 #include "ElementClasses.h"
 #include "gravity/Gravity.h"
 #include "ToolClasses.h"
 #include "SimulationData.h"
 #include "client/GameSave.h"
+#include "common/ForEachBand.h"
 #include "common/tpt-compat.h"
 #include "common/tpt-rand.h"
 #include "gui/game/Brush.h"
@@ -294,6 +296,7 @@ void Simulation::Load(const GameSave *save, bool includePressure, Vec2<int> bloc
 	{
 		air->ApproximateBlockAirMaps();
 	}
+	air->Thaw();
 }
 
 std::unique_ptr<GameSave> Simulation::Save(bool includePressure, Rect<int> partR) // particle coordinates
@@ -428,6 +431,7 @@ void Simulation::SaveSimOptions(GameSave &gameSave)
 	gameSave.customGravityX = customGravityX;
 	gameSave.customGravityY = customGravityY;
 	gameSave.airMode = air->airMode;
+	gameSave.heatMode = heatMode;
 	gameSave.ambientAirTemp = air->ambientAirTemp;
 	gameSave.edgeMode = edgeMode;
 	gameSave.legacyEnable = legacy_enable;
@@ -1012,31 +1016,13 @@ void Simulation::clear_sim(void)
 		air->ClearAirH();
 	}
 	SetEdgeMode(edgeMode);
+	viewGeneration += 1;
 }
 
 bool Simulation::IsWallBlocking(int x, int y, int type) const
 {
 	auto &sd = SimulationData::CRef();
-	auto &elements = sd.elements;
-	if (bmap[y/CELL][x/CELL])
-	{
-		int wall = bmap[y/CELL][x/CELL];
-		if (wall == WL_ALLOWGAS && !(elements[type].Properties&TYPE_GAS))
-			return true;
-		else if (wall == WL_ALLOWENERGY && !(elements[type].Properties&TYPE_ENERGY))
-			return true;
-		else if (wall == WL_ALLOWLIQUID && !(elements[type].Properties&TYPE_LIQUID))
-			return true;
-		else if (wall == WL_ALLOWPOWDER && !(elements[type].Properties&TYPE_PART))
-			return true;
-		else if (wall == WL_ALLOWAIR || wall == WL_WALL || wall == WL_WALLELEC)
-			return true;
-		else if (wall == WL_EWALL && !emap[y/CELL][x/CELL])
-			return true;
-		else if (wall == WL_DETECT && (elements[type].Properties&TYPE_SOLID))
-			return true;
-	}
-	return false;
+	return sd.WallBlocks(bmap[y/CELL][x/CELL], emap[y/CELL][x/CELL], type);
 }
 
 /*
@@ -1061,9 +1047,8 @@ int Simulation::eval_move(int pt, int nx, int ny, unsigned *rr) const
 	if (pt>=PT_NUM || TYP(r)>=PT_NUM)
 		return 0;
 	auto &sd = SimulationData::CRef();
-	auto &can_move = sd.can_move;
 	auto &elements = sd.elements;
-	result = can_move[pt][TYP(r)];
+	result = sd.CanMove(pt, TYP(r));
 	if (result == 3)
 	{
 		switch (TYP(r))
@@ -1123,7 +1108,7 @@ int Simulation::eval_move(int pt, int nx, int ny, unsigned *rr) const
 	}
 	if (bmap[ny/CELL][nx/CELL])
 	{
-		if (IsWallBlocking(nx, ny, pt))
+		if (sd.WallBlocks(bmap[ny/CELL][nx/CELL], emap[ny/CELL][nx/CELL], pt))
 			return 0;
 		if (bmap[ny/CELL][nx/CELL]==WL_EHOLE && !emap[ny/CELL][nx/CELL] && !(elements[pt].Properties&TYPE_SOLID) && !(elements[TYP(r)].Properties&TYPE_SOLID))
 			return 2;
@@ -1886,6 +1871,10 @@ int Simulation::create_part(int p, int x, int y, int t, int v)
 	}
 
 	if (i>parts_lastActiveIndex) parts_lastActiveIndex = i;
+	if (heatField)
+	{
+		heatField->Forget(i);
+	}
 
 	parts[i] = elements[t].DefaultProperties;
 	parts[i].type = t;
@@ -2092,7 +2081,6 @@ Simulation::PlanMoveResult Simulation::PlanMove(Sim &sim, int i, int x, int y)
 	auto &pmap = sim.pmap;
 	auto edgeMode = sim.edgeMode;
 	auto &sd = SimulationData::CRef();
-	auto &can_move = sd.can_move;
 	auto t = parts[i].type;
 	int fin_x, fin_y, clear_x, clear_y;
 	float fin_xf, fin_yf, clear_xf, clear_yf;
@@ -2169,7 +2157,7 @@ Simulation::PlanMoveResult Simulation::PlanMove(Sim &sim, int i, int x, int y)
 			//block if particle can't move (0), or some special cases where it returns 1 (can_move = 3 but returns 1 meaning particle will be eaten)
 			//also photons are still blocked (slowed down) by any particle (even ones it can move through), and absorb wall also blocks particles
 			int eval = sim.eval_move(t, fin_x, fin_y, NULL);
-			if (!eval || (can_move[t][TYP(pmap[fin_y][fin_x])] == 3 && eval == 1) || (t == PT_PHOT && pmap[fin_y][fin_x]) || bmap[fin_y/CELL][fin_x/CELL]==WL_DESTROYALL || closedEholeStart!=(bmap[fin_y/CELL][fin_x/CELL] == WL_EHOLE && !emap[fin_y/CELL][fin_x/CELL]))
+			if (!eval || (sd.CanMove(t, TYP(pmap[fin_y][fin_x])) == 3 && eval == 1) || (t == PT_PHOT && pmap[fin_y][fin_x]) || bmap[fin_y/CELL][fin_x/CELL]==WL_DESTROYALL || closedEholeStart!=(bmap[fin_y/CELL][fin_x/CELL] == WL_EHOLE && !emap[fin_y/CELL][fin_x/CELL]))
 			{
 				// found an obstacle
 				clear_xf = fin_xf-dx;
@@ -2394,11 +2382,14 @@ void Simulation::UpdateParticles(int start, int end)
 					auto c_heat = 0.0f;
 					float c_Cm = 0.0f;
 					int surround_hconduct[8];
+					// in HEAT_FIELD mode, HeatField::Update has already exchanged heat with pmap neighbours
+					// for the particles it covered this frame; everything else still conducts here
+					auto fieldConduction = heatMode == HEAT_FIELD && heatField && heatField->Covered(i);
 					for (auto j=0; j<8; j++)
 					{
 						surround_hconduct[j] = i;
 						auto r = surround[j];
-						if (!r)
+						if (!r || fieldConduction)
 							continue;
 						auto rt = TYP(r);
 						if (rt && elements[rt].HeatConduct && (rt!=PT_HSWC||parts[ID(r)].life==10)
@@ -2452,14 +2443,13 @@ void Simulation::UpdateParticles(int start, int end)
 						}
 					}
 
+					auto &transition = sd.transitions[t];
 					auto ctemph = pt;
 					auto ctempl = pt;
 					// change boiling point with pressure
-					if (((elements[t].Properties&TYPE_LIQUID) && sd.IsElementOrNone(elements[t].HighTemperatureTransition) && (elements[elements[t].HighTemperatureTransition].Properties&TYPE_GAS))
-					        || t==PT_LNTG || t==PT_SLTW)
+					if (transition.pressureHigh)
 						ctemph -= 2.0f*pv[y/CELL][x/CELL];
-					else if (((elements[t].Properties&TYPE_GAS) && sd.IsElementOrNone(elements[t].LowTemperatureTransition) && (elements[elements[t].LowTemperatureTransition].Properties&TYPE_LIQUID))
-					         || t==PT_WTRV)
+					else if (transition.pressureLow)
 						ctempl -= 2.0f*pv[y/CELL][x/CELL];
 					auto s = 1;
 
@@ -2467,7 +2457,7 @@ void Simulation::UpdateParticles(int start, int end)
 					if ((t==PT_ICEI || t==PT_SNOW) && (!sd.IsElement(parts[i].ctype) || parts[i].ctype==PT_ICEI || parts[i].ctype==PT_SNOW))
 						parts[i].ctype = PT_WATR;
 
-					if (elements[t].HighTemperatureTransition>-1 && ctemph>=elements[t].HighTemperature)
+					if (ctemph>=transition.high)
 					{
 						// particle type change due to high temperature
 						float dbt = ctempl - pt;
@@ -2581,7 +2571,7 @@ void Simulation::UpdateParticles(int start, int end)
 						else
 							s = 0;
 					}
-					else if (elements[t].LowTemperatureTransition > -1 && ctempl<elements[t].LowTemperature)
+					else if (ctempl<transition.low)
 					{
 						// particle type change due to low temperature
 						float dbt = ctempl - pt;
@@ -3354,6 +3344,25 @@ void Simulation::RecalcFreeParticles(bool do_life_dec)
 	NUM_PARTS = 0;
 	auto &sd = SimulationData::CRef();
 	auto &elements = sd.elements;
+	if (elementRecount)
+	{
+		// counted before the loop below kills anything, kill_part takes those off again
+		std::vector<std::array<int, PT_NUM>> bandCounts(maxBands);
+		ForEachBand(parts_lastActiveIndex + 1, 8192, [this, &elements, &bandCounts](int band, int begin, int end) {
+			auto &counts = bandCounts[band];
+			for (auto i = begin; i < end; i++)
+			{
+				auto t = parts[i].type;
+				if (t > 0 && t < PT_NUM && elements[t].Enabled)
+					counts[t]++;
+			}
+		});
+		for (auto &counts : bandCounts)
+		{
+			for (auto t = 0; t < PT_NUM; t++)
+				elementCount[t] += counts[t];
+		}
+	}
 	//the particle loop that resets the pmap/photon maps every frame, to update them.
 	for (int i = 0; i <= parts_lastActiveIndex; i++)
 	{
@@ -3382,9 +3391,6 @@ void Simulation::RecalcFreeParticles(bool do_life_dec)
 			lastPartUsed = i;
 			NUM_PARTS ++;
 
-			if (elementRecount && t >= 0 && t < PT_NUM && elements[t].Enabled)
-				elementCount[t]++;
-
 			//decrease particle life
 			if (do_life_dec && (!sys_pause || framerender))
 			{
@@ -3615,33 +3621,44 @@ void Simulation::CheckStacking()
 {
 	auto &sd = SimulationData::CRef();
 	auto &elements = sd.elements;
-	bool excessive_stacking_found = false;
 	force_stacking_check = false;
-	for (int y = 0; y < YRES; y++)
-	{
-		for (int x = 0; x < XRES; x++)
-		{
-			// Use a threshold, since some particle stacking can be normal (e.g. BIZR + FILT)
-			// Setting pmap_count[y][x] > NPART means BHOL will form in that spot
-			if (pmap_count[y][x]>5)
-			{
-				if (bmap[y/CELL][x/CELL]==WL_EHOLE)
+	// every row draws from its own stream derived from rng, so the outcome does not depend on
+	// how rows are split between threads
+	auto stackingState = rng.state();
+	rng();
+	std::array<bool, maxBands> bandFound{};
+	ForEachBand(YRES, 48, [this, &stackingState, &bandFound](int band, int begin, int end) {
+		for (int y = begin; y < end; y++)
+		{
+			RNG rowRng;
+			rowRng.state({ stackingState[0] ^ (uint64_t(y + 1) * UINT64_C(0x9E3779B97F4A7C15)), stackingState[1] });
+			for (int x = 0; x < XRES; x++)
+			{
+				// Use a threshold, since some particle stacking can be normal (e.g. BIZR + FILT)
+				// Setting pmap_count[y][x] > NPART means BHOL will form in that spot
+				if (pmap_count[y][x]>5)
 				{
-					// Allow more stacking in E-hole
-					if (pmap_count[y][x]>1500)
+					if (bmap[y/CELL][x/CELL]==WL_EHOLE)
+					{
+						// Allow more stacking in E-hole
+						if (pmap_count[y][x]>1500)
+						{
+							pmap_count[y][x] = pmap_count[y][x] + NPART;
+							bandFound[band] = true;
+						}
+					}
+					else if (pmap_count[y][x]>1500 || (unsigned int)rowRng.between(0, 1599) <= (pmap_count[y][x]+100))
 					{
 						pmap_count[y][x] = pmap_count[y][x] + NPART;
-						excessive_stacking_found = 1;
+						bandFound[band] = true;
 					}
 				}
-				else if (pmap_count[y][x]>1500 || (unsigned int)rng.between(0, 1599) <= (pmap_count[y][x]+100))
-				{
-					pmap_count[y][x] = pmap_count[y][x] + NPART;
-					excessive_stacking_found = true;
-				}
 			}
 		}
-	}
+	});
+	auto excessive_stacking_found = std::any_of(bandFound.begin(), bandFound.end(), [](bool found) {
+		return found;
+	});
 	if (excessive_stacking_found)
 	{
 		for (int i = 0; i <= parts_lastActiveIndex; i++)
@@ -3689,10 +3706,15 @@ void Simulation::BeforeSim()
 			grav->gravity_update_async();
 
 			//Get updated buffer pointers for gravity
+			auto *oldGravmap = gravmap;
 			gravx = &grav->gravx[0];
 			gravy = &grav->gravy[0];
 			gravp = &grav->gravp[0];
 			gravmap = &grav->gravmap[0];
+			if (gravmap != oldGravmap) // gravmap is swapped with the gravity thread's copy
+			{
+				viewGeneration += 1;
+			}
 		}
 		if(emp_decor>0)
 			emp_decor -= emp_decor/25+2;
@@ -3741,6 +3763,15 @@ void Simulation::BeforeSim()
 			CheckStacking();
 		}
 
+		if (heatMode == HEAT_FIELD && !legacy_enable)
+		{
+			if (!heatField)
+			{
+				heatField = std::make_unique<HeatField>(*this);
+			}
+			heatField->Update();
+		}
+
 		// LOVE and LOLZ element handling
 		if (elementCount[PT_LOVE] > 0 || elementCount[PT_LOLZ] > 0)
 		{
@@ -3904,6 +3935,7 @@ Simulation::Simulation():
 	customGravityX(0),
 	customGravityY(0),
 	legacy_enable(0),
+	heatMode(HEAT_STOCHASTIC),
 	aheat_enable(0),
 	water_equal_test(0),
 	sys_pause(0),
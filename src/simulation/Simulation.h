@@ -30,6 +30,7 @@ class Simulation;
 class Renderer;
 class Gravity;
 class Air;
+class HeatField;
 class GameSave;
 
 class Simulation
@@ -37,6 +38,7 @@ class Simulation
 public:
 	GravityPtr grav;
 	std::unique_ptr<Air> air;
+	std::unique_ptr<HeatField> heatField; // only allocated once HEAT_FIELD is used
 	RNG rng;
 
 	std::vector<sign> signs;
@@ -85,6 +87,9 @@ public:
 	float *gravy;//gravy[YCELLS * XCELLS];
 	float *gravp;//gravp[YCELLS * XCELLS];
 	float *gravmap;//gravmap[YCELLS * XCELLS];
+	// Bumped whenever raw pointers handed out to scripts (see sim.ffiViews) may have gone stale
+	// or the data behind them was replaced wholesale; scripts compare it against the value they fetched.
+	uint64_t viewGeneration = 0;
 	//Walls
 	unsigned char bmap[YCELLS][XCELLS];
 	unsigned char emap[YCELLS][XCELLS];
@@ -101,6 +106,7 @@ public:
 	float customGravityX;
 	float customGravityY;
 	int legacy_enable;
+	int heatMode;
 	int aheat_enable;
 	int water_equal_test;
 	int sys_pause;
@@ -9,6 +9,7 @@
 #include "ToolClasses.h"
 #include "Misc.h"
 #include "graphics/Renderer.h"
+#include <limits>
 
 const std::array<BuiltinGOL, NGOL> SimulationData::builtinGol = {{
 	// * Ruleset:
@@ -235,6 +236,88 @@ void SimulationData::init_can_move()
 	can_move[PT_TRON][PT_SWCH] = 3;
 	can_move[PT_ELEC][PT_RSST] = 2;
 	can_move[PT_ELEC][PT_RSSS] = 2;
+	compile_can_move();
+}
+
+void SimulationData::compile_can_move()
+{
+	// slot 0 is shared by IDs of disabled elements, nothing moves into or out of it; leftover
+	// particles of an element freed since the last compile thus stay where they are
+	canMoveCount = 1;
+	for (auto type = 0; type < PT_NUM; type++)
+	{
+		canMoveIndex[type] = (!type || elements[type].Enabled) ? canMoveCount++ : 0;
+	}
+	canMovePacked.assign((canMoveCount * canMoveCount + 3) / 4, 0);
+	for (auto movingType = 0; movingType < PT_NUM; movingType++)
+	{
+		for (auto destinationType = 0; destinationType < PT_NUM; destinationType++)
+		{
+			if (canMoveIndex[movingType] && canMoveIndex[destinationType])
+			{
+				auto index = canMoveIndex[movingType] * canMoveCount + canMoveIndex[destinationType];
+				canMovePacked[index >> 2] |= (can_move[movingType][destinationType] & 3) << ((index & 3) * 2);
+			}
+		}
+	}
+
+	for (auto wall = 0; wall < int(wallBlockRules.size()); wall++)
+	{
+		for (auto powered = 0; powered < 2; powered++)
+		{
+			auto rule = WALLBLOCK_NONE;
+			switch (wall)
+			{
+			case WL_ALLOWGAS:    rule = WALLBLOCK_NOT_GAS;                        break;
+			case WL_ALLOWENERGY: rule = WALLBLOCK_NOT_ENERGY;                     break;
+			case WL_ALLOWLIQUID: rule = WALLBLOCK_NOT_LIQUID;                     break;
+			case WL_ALLOWPOWDER: rule = WALLBLOCK_NOT_POWDER;                     break;
+			case WL_ALLOWAIR:
+			case WL_WALL:
+			case WL_WALLELEC:    rule = WALLBLOCK_ALL;                            break;
+			case WL_EWALL:       rule = powered ? WALLBLOCK_NONE : WALLBLOCK_ALL; break;
+			case WL_DETECT:      rule = WALLBLOCK_SOLID;                          break;
+			}
+			wallBlockRules[wall][powered] = rule;
+		}
+	}
+	for (auto type = 0; type < PT_NUM; type++)
+	{
+		auto properties = elements[type].Properties;
+		uint8_t mask = 1 << WALLBLOCK_ALL;
+		if (!(properties & TYPE_GAS   )) mask |= 1 << WALLBLOCK_NOT_GAS;
+		if (!(properties & TYPE_ENERGY)) mask |= 1 << WALLBLOCK_NOT_ENERGY;
+		if (!(properties & TYPE_LIQUID)) mask |= 1 << WALLBLOCK_NOT_LIQUID;
+		if (!(properties & TYPE_PART  )) mask |= 1 << WALLBLOCK_NOT_POWDER;
+		if (  properties & TYPE_SOLID  ) mask |= 1 << WALLBLOCK_SOLID;
+		wallBlockMask[type] = mask;
+	}
+}
+
+void SimulationData::set_can_move(int movingType, int destinationType, int setting)
+{
+	can_move[movingType][destinationType] = setting;
+	if (canMoveIndex[movingType] && canMoveIndex[destinationType])
+	{
+		auto index = canMoveIndex[movingType] * canMoveCount + canMoveIndex[destinationType];
+		auto shift = (index & 3) * 2;
+		canMovePacked[index >> 2] = (canMovePacked[index >> 2] & ~(3 << shift)) | ((setting & 3) << shift);
+	}
+}
+
+void SimulationData::compile_transitions()
+{
+	for (auto t = 0; t < PT_NUM; t++)
+	{
+		auto &elem = elements[t];
+		auto &transition = transitions[t];
+		transition.high = elem.HighTemperatureTransition > -1 ? elem.HighTemperature : std::numeric_limits<float>::max();
+		transition.low = elem.LowTemperatureTransition > -1 ? elem.LowTemperature : std::numeric_limits<float>::lowest();
+		transition.pressureHigh = ((elem.Properties & TYPE_LIQUID) && IsElementOrNone(elem.HighTemperatureTransition) && (elements[elem.HighTemperatureTransition].Properties & TYPE_GAS))
+		                          || t == PT_LNTG || t == PT_SLTW;
+		transition.pressureLow = !transition.pressureHigh && (((elem.Properties & TYPE_GAS) && IsElementOrNone(elem.LowTemperatureTransition) && (elements[elem.LowTemperatureTransition].Properties & TYPE_LIQUID))
+		                                                      || t == PT_WTRV);
+	}
 }
 
 const CustomGOLData *SimulationData::GetCustomGOLByRule(int rule) const
@@ -338,4 +421,5 @@ SimulationData::SimulationData()
 	elements = GetElements();
 	tools = GetTools();
 	init_can_move();
+	compile_transitions();
 }
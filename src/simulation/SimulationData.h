@@ -77,6 +77,18 @@ constexpr int WL_FLOODHELPER  =255;
 
 constexpr int UI_WALLCOUNT = 19;
 
+// Which elements a wall blocks, see SimulationData::wallBlockRules
+enum WallBlockRule
+{
+	WALLBLOCK_NONE,
+	WALLBLOCK_ALL,
+	WALLBLOCK_NOT_GAS,
+	WALLBLOCK_NOT_ENERGY,
+	WALLBLOCK_NOT_LIQUID,
+	WALLBLOCK_NOT_POWDER,
+	WALLBLOCK_SOLID,
+};
+
 constexpr int OLD_SPC_AIR = 236;
 constexpr int SPC_AIR     = 256;
 
@@ -154,6 +166,11 @@ enum AirMode
 	AIR_ON, AIR_PRESSUREOFF, AIR_VELOCITYOFF, AIR_OFF, AIR_NOUPDATE, NUM_AIRMODES
 };
 
+enum HeatMode
+{
+	HEAT_STOCHASTIC, HEAT_FIELD, NUM_HEATMODES
+};
+
 enum GravityMode
 {
 	GRAV_VERTICAL, GRAV_OFF, GRAV_RADIAL, GRAV_CUSTOM, NUM_GRAVMODES
@@ -188,6 +205,27 @@ public:
 	std::vector<wall_type> wtypes;
 	std::vector<menu_section> msections;
 	char can_move[PT_NUM][PT_NUM];
+	// Compiled from can_move and element properties by compile_can_move, which has to be called
+	// whenever either changes. Enabled element IDs are renumbered densely and entries are packed
+	// to 2 bits, which keeps the table small enough to stay in L1 while particles move.
+	std::array<uint16_t, PT_NUM> canMoveIndex;
+	int canMoveCount;
+	std::vector<uint8_t> canMovePacked;
+	// wallBlockRules[wall][powered], and bit n of wallBlockMask[type] is set if rule n blocks type
+	std::array<std::array<uint8_t, 2>, 256> wallBlockRules;
+	std::array<uint8_t, PT_NUM> wallBlockMask;
+	// Compiled from element transition properties by compile_transitions, which has to be called
+	// whenever they change. A particle can only change type due to its temperature if its pressure
+	// adjusted temperature reaches high or drops below low; elements without such a transition get
+	// thresholds no temperature can reach.
+	struct TransitionThresholds
+	{
+		float high;
+		float low;
+		bool pressureHigh; // boiling point drops with pressure
+		bool pressureLow; // condensation point drops with pressure
+	};
+	std::array<TransitionThresholds, PT_NUM> transitions;
 	static const std::array<BuiltinGOL, NGOL> builtinGol;
 
 	// Element properties that enable basic graphics (i.e. every property that has to do with graphics other than
@@ -206,6 +244,20 @@ public:
 	void InitElements();
 
 	void init_can_move();
+	void compile_can_move();
+	void set_can_move(int movingType, int destinationType, int setting);
+	void compile_transitions();
+
+	int CanMove(int movingType, int destinationType) const
+	{
+		auto index = canMoveIndex[movingType] * canMoveCount + canMoveIndex[destinationType];
+		return (canMovePacked[index >> 2] >> ((index & 3) * 2)) & 3;
+	}
+
+	bool WallBlocks(int wall, bool powered, int type) const
+	{
+		return (wallBlockMask[type] >> wallBlockRules[wall][powered ? 1 : 0]) & 1;
+	}
 
 	const CustomGOLData *GetCustomGOLByRule(int rule) const;
 	const std::vector<CustomGOLData> &GetCustomGol() const { return customGol; }